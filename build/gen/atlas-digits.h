@@ -0,0 +1,36 @@
+/**
+ * FlappyBird-N64 - atlas-digits.h
+ *
+ * Generated by gfxtool from resources/gfx/manifest.txt; do not edit.
+ */
+
+#ifndef __FLAPPY_ATLAS_DIGITS_H
+#define __FLAPPY_ATLAS_DIGITS_H
+
+#include "atlas.h"
+
+#define ATLAS_DIGITS_NAME "atlas-digits"
+#define ATLAS_DIGITS_WIDTH 192
+#define ATLAS_DIGITS_HEIGHT 18
+
+#define ATLAS_DIGITS_PAGES_COUNT 1
+
+typedef enum
+{
+    ATLAS_DIGITS_FONT_LARGE,
+    ATLAS_DIGITS_FONT_MEDIUM,
+    ATLAS_DIGITS_RECTS_COUNT // Not a rect; just a count
+} atlas_digits_rect_t;
+
+static const atlas_page_t ATLAS_DIGITS_PAGES[ATLAS_DIGITS_PAGES_COUNT] = {
+    [0] = { 0, 18 },
+};
+
+static const atlas_rect_t ATLAS_DIGITS_RECTS[ATLAS_DIGITS_PAGES_COUNT][ATLAS_DIGITS_RECTS_COUNT] = {
+    [0] = {
+        [ATLAS_DIGITS_FONT_LARGE] = { 0, 0, 120, 18, 10, 1 },
+        [ATLAS_DIGITS_FONT_MEDIUM] = { 120, 0, 70, 10, 10, 1 },
+    },
+};
+
+#endif
@@ -0,0 +1,66 @@
+/**
+ * FlappyBird-N64 - atlas-ui.h
+ *
+ * Generated by gfxtool from resources/gfx/manifest.txt; do not edit.
+ */
+
+#ifndef __FLAPPY_ATLAS_UI_H
+#define __FLAPPY_ATLAS_UI_H
+
+#include "atlas.h"
+
+#define ATLAS_UI_NAME "atlas-ui"
+#define ATLAS_UI_WIDTH 24
+#define ATLAS_UI_HEIGHT 144
+
+typedef enum
+{
+    ATLAS_UI_PAGE_MEDAL_BRONZE,
+    ATLAS_UI_PAGE_MEDAL_SILVER,
+    ATLAS_UI_PAGE_MEDAL_GOLD,
+    ATLAS_UI_PAGE_MEDAL_PLATINUM,
+    ATLAS_UI_PAGES_COUNT // Not a page; just a count
+} atlas_ui_page_t;
+
+typedef enum
+{
+    ATLAS_UI_MEDAL_BRONZE,
+    ATLAS_UI_MEDAL_SILVER,
+    ATLAS_UI_MEDAL_GOLD,
+    ATLAS_UI_MEDAL_PLATINUM,
+    ATLAS_UI_NEW,
+    ATLAS_UI_SPARKLE,
+    ATLAS_UI_RECTS_COUNT // Not a rect; just a count
+} atlas_ui_rect_t;
+
+static const atlas_page_t ATLAS_UI_PAGES[ATLAS_UI_PAGES_COUNT] = {
+    [ATLAS_UI_PAGE_MEDAL_BRONZE] = { 0, 36 },
+    [ATLAS_UI_PAGE_MEDAL_SILVER] = { 36, 36 },
+    [ATLAS_UI_PAGE_MEDAL_GOLD] = { 72, 36 },
+    [ATLAS_UI_PAGE_MEDAL_PLATINUM] = { 108, 36 },
+};
+
+static const atlas_rect_t ATLAS_UI_RECTS[ATLAS_UI_PAGES_COUNT][ATLAS_UI_RECTS_COUNT] = {
+    [ATLAS_UI_PAGE_MEDAL_BRONZE] = {
+        [ATLAS_UI_MEDAL_BRONZE] = { 0, 0, 22, 22, 1, 1 },
+        [ATLAS_UI_NEW] = { 0, 23, 16, 7, 1, 1 },
+        [ATLAS_UI_SPARKLE] = { 0, 31, 15, 5, 3, 1 },
+    },
+    [ATLAS_UI_PAGE_MEDAL_SILVER] = {
+        [ATLAS_UI_MEDAL_SILVER] = { 0, 36, 22, 22, 1, 1 },
+        [ATLAS_UI_NEW] = { 0, 59, 16, 7, 1, 1 },
+        [ATLAS_UI_SPARKLE] = { 0, 67, 15, 5, 3, 1 },
+    },
+    [ATLAS_UI_PAGE_MEDAL_GOLD] = {
+        [ATLAS_UI_MEDAL_GOLD] = { 0, 72, 22, 22, 1, 1 },
+        [ATLAS_UI_NEW] = { 0, 95, 16, 7, 1, 1 },
+        [ATLAS_UI_SPARKLE] = { 0, 103, 15, 5, 3, 1 },
+    },
+    [ATLAS_UI_PAGE_MEDAL_PLATINUM] = {
+        [ATLAS_UI_MEDAL_PLATINUM] = { 0, 108, 22, 22, 1, 1 },
+        [ATLAS_UI_NEW] = { 0, 131, 16, 7, 1, 1 },
+        [ATLAS_UI_SPARKLE] = { 0, 139, 15, 5, 3, 1 },
+    },
+};
+
+#endif
@@ -1,14 +1,22 @@
 #!/usr/bin/env bash
 #
-# Convert pngs into 16-bit libdragon sprites
+# Convert pngs into libdragon sprites using the formats in the manifest
+#
+# Usage:
+#   convert_gfx.bash                 Convert everything in the manifest
+#   convert_gfx.bash <png>...        Convert specific PNG files
+#   convert_gfx.bash --atlas <name>  Pack an atlas PNG and header from its members
 #
 
 set -euo pipefail
 
 # Provide sensible defaults, but these should be set by the Makefile
 [ -z ${MKSPRITE+x} ] && MKSPRITE="libdragon/tools/mksprite/mksprite"
+[ -z ${GFXTOOL+x} ] && GFXTOOL="build/tools/gfxtool"
 [ -z ${PNG_DIR+x} ] && PNG_DIR="resources/gfx"
+[ -z ${GEN_DIR+x} ] && GEN_DIR="build/gen"
 [ -z ${SPRITE_DIR+x} ] && SPRITE_DIR="build/filesystem/gfx"
+[ -z ${VERBOSE+x} ] && VERBOSE=""
 
 # Ensure the `mksprite` command exists
 command -v ${MKSPRITE} >/dev/null 2>&1 || { \
@@ -19,20 +27,42 @@ command -v ${MKSPRITE} >/dev/null 2>&1 || { \
 
 PNG_EXT=".png"
 SPRITE_EXT=".sprite"
+TLUT_EXT=".tlut"
 MANIFEST="${PNG_DIR}/manifest.txt"
-BIT_DEPTH=16
+
+# Print manifest lines without comments or blank lines
+manifest_lines() {
+    grep -Ev '^\s*(#|$)' ${MANIFEST}
+}
+
+# Print the value of a "key=value" manifest option, if present
+manifest_option() {
+    local KEY=$1
+    shift
+    for OPTION in "$@"; do
+        if [ "${OPTION%%=*}" == "${KEY}" ]; then
+            echo "${OPTION#*=}"
+            return
+        fi
+    done
+}
+
+# Run a command, hiding its output unless VERBOSE is set
+run_quiet() {
+    if [ -n "$VERBOSE" ]; then "$@"; else "$@" >/dev/null; fi
+}
 
 convert_png_to_sprite() {
     local PNG_FILE=$1
     FILE_BASENAME=$(basename -s ${PNG_EXT} ${PNG_FILE})
     # Look up the file in the manifest
-    LINE=$(grep -Ee "^${FILE_BASENAME}\s+" ${MANIFEST})
+    LINE=$(manifest_lines | grep -Ee "^${FILE_BASENAME}\s+" || true)
     # Assume a 1x1 sprite if it's not in the manifest
     if [ -z "$LINE" ]; then
         echo >&2 "WARNING: PNG file '${PNG_FILE}' is not in the manifest!"
-        LINE="${FILE_BASENAME} 1 1"
+        LINE="${FILE_BASENAME} 1 1 AUTO"
     fi
-    convert_manifest_line_to_sprite "$LINE"
+    convert_manifest_line_to_sprite "$LINE" "$PNG_FILE"
 }
 
 convert_manifest_line_to_sprite() {
@@ -43,19 +73,91 @@ convert_manifest_line_to_sprite() {
     FILE_BASENAME=${META[0]}
     H_SLICES=${META[1]}
     V_SLICES=${META[2]}
-    # Build a sprite from the filenames and slicing metadata
-    PNG_FILE="${PNG_DIR}/${FILE_BASENAME}${PNG_EXT}"
+    FORMAT=${META[3]:-AUTO}
+    ATLAS=$(manifest_option atlas "${META[@]:4}")
+    VARIANTS=$(manifest_option variants "${META[@]:4}")
+    TLUT_BASE=$(manifest_option tlut "${META[@]:4}")
+    # Atlas members are converted as part of their atlas
+    if [ -n "$ATLAS" ]; then
+        echo >&2 "WARNING: '${FILE_BASENAME}' is packed into '${ATLAS}'; skipping."
+        return
+    fi
+    PNG_FILE=${2:-"${PNG_DIR}/${FILE_BASENAME}${PNG_EXT}"}
     SPRITE_FILE="${SPRITE_DIR}/${FILE_BASENAME}${SPRITE_EXT}"
-    $MKSPRITE $BIT_DEPTH $H_SLICES $V_SLICES $PNG_FILE $SPRITE_FILE
+    if [ -n "$VARIANTS" ]; then
+        # Split color variants into an index image (stored as I4/I8) and a TLUT
+        INDEX_PNG_FILE="${GEN_DIR}/${FILE_BASENAME}${PNG_EXT}"
+        TLUT_FILE="${SPRITE_DIR}/${FILE_BASENAME}${TLUT_EXT}"
+        mkdir -p ${GEN_DIR}
+        read FORMAT WIDTH HEIGHT COLORS BYTES RGBA16_BYTES <<<$($GFXTOOL variants \
+            -g $VARIANTS -b ${TLUT_BASE:-0} $PNG_FILE $FORMAT $INDEX_PNG_FILE $TLUT_FILE)
+        MKSPRITE_FORMAT="I${FORMAT#CI}"
+        PNG_FILE=$INDEX_PNG_FILE
+    else
+        # Resolve AUTO (or sanity-check an explicit format) against the PNG
+        read FORMAT WIDTH HEIGHT COLORS BYTES RGBA16_BYTES <<<$($GFXTOOL format $PNG_FILE $FORMAT)
+        MKSPRITE_FORMAT=$FORMAT
+    fi
+    # Build a sprite from the filenames, format and slicing metadata
+    run_quiet $MKSPRITE --format $MKSPRITE_FORMAT --tiles $((WIDTH / H_SLICES)),$((HEIGHT / V_SLICES)) \
+        --output $SPRITE_DIR $PNG_FILE
+    report_savings
+}
+
+# Summarize what the chosen format saves over the old all-RGBA16 pipeline;
+# the sprite header is the same either way, so ROM and RDRAM savings match
+report_savings() {
+    local SPRITE_BYTES=$(wc -c <${SPRITE_FILE})
+    local SAVED=$((RGBA16_BYTES - BYTES))
+    printf "%-16s %-6s %3dx%-3d %3d colors  rom %6d B  rdram %6d B  saves %6d B (%d%%)\n" \
+        ${FILE_BASENAME} ${FORMAT} ${WIDTH} ${HEIGHT} ${COLORS} \
+        ${SPRITE_BYTES} ${BYTES} ${SAVED} $((SAVED * 100 / RGBA16_BYTES))
+}
+
+pack_atlas() {
+    local ATLAS_NAME=$1
+    local MEMBERS=()
+    local FORMAT=AUTO
+    # Collect "<png>:<hslices>:<vslices>:<pages>" for every member, in manifest order
+    while read -a META; do
+        if [ "${META[0]}" == "${ATLAS_NAME}" ]; then
+            FORMAT=${META[3]:-AUTO}
+        elif [ "$(manifest_option atlas "${META[@]:4}")" == "${ATLAS_NAME}" ]; then
+            MEMBERS+=("${PNG_DIR}/${META[0]}${PNG_EXT}:${META[1]}:${META[2]}:$(manifest_option page "${META[@]:4}")")
+        fi
+    done < <(manifest_lines)
+    if [ ${#MEMBERS[@]} -eq 0 ]; then
+        echo >&2 "ERROR: atlas '${ATLAS_NAME}' has no members in the manifest!"
+        exit 1
+    fi
+    mkdir -p ${GEN_DIR}
+    # Pages are checked against TMEM in the format the atlas will be converted to
+    $GFXTOOL atlas -f ${FORMAT} "${GEN_DIR}/${ATLAS_NAME}${PNG_EXT}" "${GEN_DIR}/${ATLAS_NAME}.h" "${MEMBERS[@]}"
 }
 
 mkdir -p ${SPRITE_DIR}
 
 if [ $# -eq 0 ]; then
+    # Pack every atlas first so that atlas sprites can be converted below
+    for ATLAS_NAME in $(manifest_lines | grep -Eo '\batlas=\S+' | cut -d= -f2 | sort -u); do
+        pack_atlas "${ATLAS_NAME}"
+    done
     # Loop through the manifest and convert everything
     while read LINE; do
-      convert_manifest_line_to_sprite "${LINE}"
-    done < ${MANIFEST}
+        read -a META <<<$LINE
+        [ -n "$(manifest_option atlas "${META[@]:4}")" ] && continue
+        # Atlases only exist as generated PNGs
+        if [ -f "${PNG_DIR}/${META[0]}${PNG_EXT}" ]; then
+            convert_manifest_line_to_sprite "${LINE}"
+        else
+            convert_manifest_line_to_sprite "${LINE}" "${GEN_DIR}/${META[0]}${PNG_EXT}"
+        fi
+    done < <(manifest_lines)
+elif [ "$1" == "--atlas" ]; then
+    shift
+    for ATLAS_NAME in "$@"; do
+        pack_atlas "${ATLAS_NAME}"
+    done
 else
     # Convert command-line arguments
     for FILE in "$@"; do
@@ -0,0 +1,78 @@
+/**
+ * FlappyBird-N64 - atlas.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "atlas.h"
+
+#include "gfx.h"
+
+/* Atlas implementation */
+
+atlas_t *atlas_load(const char *name, const atlas_page_t *pages, size_t pages_count,
+    const atlas_rect_t *rects, size_t rects_count)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "rom:/gfx/%s.sprite", name);
+    atlas_t *const atlas = malloc(sizeof(atlas_t));
+    atlas->sprite = sprite_load(path);
+    atlas->pages = pages;
+    atlas->pages_count = pages_count;
+    atlas->rects = rects;
+    atlas->rects_count = rects_count;
+    return atlas;
+}
+
+void atlas_free(atlas_t *atlas)
+{
+    sprite_free(atlas->sprite);
+    atlas->sprite = NULL;
+    free(atlas);
+}
+
+const atlas_rect_t *atlas_get_rect(const atlas_t *atlas, size_t page_id, size_t rect_id)
+{
+    assert(page_id < atlas->pages_count);
+    assert(rect_id < atlas->rects_count);
+    const atlas_rect_t *const rect = &atlas->rects[page_id * atlas->rects_count + rect_id];
+    assertf(rect->width > 0, "Atlas rect %u is not on page %u", rect_id, page_id);
+    return rect;
+}
+
+/*
+ * Load one page (and the palette, for CI atlases) into TILE0; gfxtool has
+ * checked that it fits. Any number of atlas_draw calls on the same page can
+ * follow until something else uses TMEM.
+ */
+void atlas_begin(const atlas_t *atlas, size_t page_id)
+{
+    assert(page_id < atlas->pages_count);
+    const atlas_page_t *const page = &atlas->pages[page_id];
+    surface_t surface = sprite_get_pixels(atlas->sprite);
+    const tex_format_t format = surface_get_format(&surface);
+    rdpq_set_mode_standard();
+    rdpq_mode_alphacompare(1);
+    if (format == FMT_CI4 || format == FMT_CI8)
+    {
+        rdpq_mode_tlut(TLUT_RGBA16);
+        rdpq_tex_upload_tlut(sprite_get_palette(atlas->sprite), 0, format == FMT_CI4 ? 16 : 256);
+    }
+    rdpq_tex_upload_sub(TILE0, &surface, NULL, 0, page->y, surface.width, page->y + page->height);
+}
+
+/* One texture rectangle from the page loaded by atlas_begin */
+void atlas_draw(const atlas_t *atlas, size_t page_id, size_t rect_id, int hslice, int vslice,
+    float x, float y)
+{
+    const atlas_rect_t *const rect = atlas_get_rect(atlas, page_id, rect_id);
+    const int slice_w = atlas_rect_slice_w(rect);
+    const int slice_h = atlas_rect_slice_h(rect);
+    const int s0 = rect->x + hslice * slice_w;
+    const int t0 = rect->y + vslice * slice_h;
+    rdpq_texture_rectangle_scaled(TILE0, x, y, x + slice_w * gfx->scale_x, y + slice_h * gfx->scale_y,
+        s0, t0, s0 + slice_w, t0 + slice_h);
+}
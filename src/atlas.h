@@ -0,0 +1,71 @@
+/**
+ * FlappyBird-N64 - atlas.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_ATLAS_H
+#define __FLAPPY_ATLAS_H
+
+#include "system.h"
+
+/* Atlas definitions */
+
+/* Atlases without named pages have just this one */
+#define ATLAS_PAGE_ALL 0
+
+/* Rows of the atlas that are uploaded to TMEM together */
+typedef struct atlas_page_s
+{
+    uint16_t y;
+    uint16_t height;
+} atlas_page_t;
+
+/* Sub-rectangle of a packed sprite; generated by gfxtool from manifest.txt */
+typedef struct atlas_rect_s
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+    uint8_t hslices;
+    uint8_t vslices;
+} atlas_rect_t;
+
+typedef struct atlas_s
+{
+    sprite_t *sprite;
+    const atlas_page_t *pages;
+    size_t pages_count;
+    const atlas_rect_t *rects; // rects_count per page; empty where not placed
+    size_t rects_count;
+} atlas_t;
+
+static inline int atlas_rect_slice_w(const atlas_rect_t *rect)
+{
+    return rect->width / rect->hslices;
+}
+
+static inline int atlas_rect_slice_h(const atlas_rect_t *rect)
+{
+    return rect->height / rect->vslices;
+}
+
+/* Atlas functions */
+
+atlas_t *atlas_load(const char *name, const atlas_page_t *pages, size_t pages_count,
+    const atlas_rect_t *rects, size_t rects_count);
+
+void atlas_free(atlas_t *atlas);
+
+const atlas_rect_t *atlas_get_rect(const atlas_t *atlas, size_t page_id, size_t rect_id);
+
+void atlas_begin(const atlas_t *atlas, size_t page_id);
+
+void atlas_draw(const atlas_t *atlas, size_t page_id, size_t rect_id, int hslice, int vslice,
+    float x, float y);
+
+#endif
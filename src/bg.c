@@ -11,6 +11,9 @@
 
 #include "system.h"
 #include "gfx.h"
+#include "palette.h"
+#include "panel.h"
+#include "pace.h"
 
 /* Background constants */
 
@@ -34,51 +37,66 @@
 #define BG_GROUND_FILL_Y        ((int) 200)
 #define BG_GROUND_FILL_H        ((int) 40)
 
-static color_t BG_COLOR_DAY_SKY     = {0};
-static color_t BG_COLOR_NIGHT_SKY   = {0};
-static color_t BG_COLOR_DAY_CLOUD   = {0};
-static color_t BG_COLOR_NIGHT_CLOUD = {0};
-static color_t BG_COLOR_DAY_HILL    = {0};
-static color_t BG_COLOR_NIGHT_HILL  = {0};
-static color_t BG_COLOR_GROUND      = {0};
+/* Sunset/sunrise */
+#define BG_TIME_FADE_TICKS      (3000 * TICKS_PER_MS)
+/* 5-bit palette channels never need more than 32 steps per fade */
+#define BG_TIME_RAMP_STEPS      32
+
+// These arrays must line up with bg_time_mode_t
+static color_t BG_COLORS_SKY[BG_TIME_MODES_COUNT]   = {0};
+static color_t BG_COLORS_CLOUD[BG_TIME_MODES_COUNT] = {0};
+static color_t BG_COLORS_HILL[BG_TIME_MODES_COUNT]  = {0};
+static color_t BG_COLOR_GROUND                      = {0};
 
 static inline void bg_init_colors(void)
 {
-    BG_COLOR_DAY_SKY     = RGBA32(0x4E, 0xC0, 0xCA, 0xFF);
-    BG_COLOR_NIGHT_SKY   = RGBA32(0x00, 0x87, 0x93, 0xFF);
-    BG_COLOR_DAY_CLOUD   = RGBA32(0xE4, 0xFD, 0xD0, 0xFF);
-    BG_COLOR_NIGHT_CLOUD = RGBA32(0x15, 0xA5, 0xB5, 0xFF);
-    BG_COLOR_DAY_HILL    = RGBA32(0x52, 0xE0, 0x5D, 0xFF);
-    BG_COLOR_NIGHT_HILL  = RGBA32(0x14, 0x96, 0x02, 0xFF);
-    BG_COLOR_GROUND      = RGBA32(0xDF, 0xD8, 0x93, 0xFF);
+    BG_COLORS_SKY[BG_TIME_DAY]     = RGBA32(0x4E, 0xC0, 0xCA, 0xFF);
+    BG_COLORS_SKY[BG_TIME_NIGHT]   = RGBA32(0x00, 0x87, 0x93, 0xFF);
+    BG_COLORS_CLOUD[BG_TIME_DAY]   = RGBA32(0xE4, 0xFD, 0xD0, 0xFF);
+    BG_COLORS_CLOUD[BG_TIME_NIGHT] = RGBA32(0x15, 0xA5, 0xB5, 0xFF);
+    BG_COLORS_HILL[BG_TIME_DAY]    = RGBA32(0x52, 0xE0, 0x5D, 0xFF);
+    BG_COLORS_HILL[BG_TIME_NIGHT]  = RGBA32(0x14, 0x96, 0x02, 0xFF);
+    BG_COLOR_GROUND                = RGBA32(0xDF, 0xD8, 0x93, 0xFF);
 }
 
 /* Background types */
 
 typedef enum
 {
-    BG_SPRITE_CLOUD_DAY,
-    BG_SPRITE_CLOUD_NIGHT,
-    BG_SPRITE_CITY_DAY,
-    BG_SPRITE_CITY_NIGHT,
-    BG_SPRITE_HILL_DAY,
-    BG_SPRITE_HILL_NIGHT,
+    BG_SPRITE_CLOUD,
+    BG_SPRITE_CITY,
+    BG_SPRITE_HILL,
     BG_SPRITE_GROUND,
     // Additional sprites go above this line
     BG_SPRITES_COUNT, // Not an actual sprite, just a handy counter
 } bg_sprite_t;
 
-// This array must line up with bg_sprite_t
+// These arrays must line up with bg_sprite_t
 static const char *const BG_SPRITE_FILES[BG_SPRITES_COUNT] = {
-    "rom:/gfx/bg-cloud-day.sprite",
-    "rom:/gfx/bg-cloud-night.sprite",
-    "rom:/gfx/bg-city-day.sprite",
-    "rom:/gfx/bg-city-night.sprite",
-    "rom:/gfx/bg-hill-day.sprite",
-    "rom:/gfx/bg-hill-night.sprite",
+    "rom:/gfx/bg-cloud.sprite",
+    "rom:/gfx/bg-city.sprite",
+    "rom:/gfx/bg-hill.sprite",
     "rom:/gfx/ground.sprite",
 };
 
+/* Layers with a palette per time mode; the ground looks the same at night */
+static const char *const BG_SPRITE_PALETTES[BG_SPRITES_COUNT] = {
+    "bg-cloud",
+    "bg-city",
+    "bg-hill",
+    NULL,
+};
+
+/* Background bands pre-baked per time mode, each scrolling with one layer */
+typedef enum
+{
+    BG_BAND_CLOUD,
+    BG_BAND_CITY,
+    BG_BAND_HILL,
+    // Additional bands go above this line
+    BG_BANDS_COUNT, // Not an actual band, just a handy counter
+} bg_band_t;
+
 typedef struct bg_fill_color_s
 {
     color_t color;
@@ -99,9 +117,14 @@ static struct background_s
 {
     bool initialized;
     sprite_t *sprites[BG_SPRITES_COUNT];
+    palette_t *palettes[BG_SPRITES_COUNT];
     // Setup state
     bg_time_mode_t time_mode;
     uint64_t scroll_ticks;
+    // Time of day, in time modes; fades toward time_mode
+    float time_pos;
+    int time_ramp_row;
+    uint64_t time_ticks;
     // Color fills
     bg_fill_color_t sky_fill;
     bg_fill_color_t cloud_fill;
@@ -112,10 +135,17 @@ static struct background_s
     bg_fill_sprite_t city;
     bg_fill_sprite_t hill_top;
     bg_fill_sprite_t ground_top;
+    // Pre-baked bands, valid for the baked scale only
+    panel_t bands[BG_BANDS_COUNT][BG_TIME_MODES_COUNT];
+    float baked_scale_x;
+    float baked_scale_y;
+    bool baked; // Every band is valid
 } bg = {0};
 
 /* Background implementation */
 
+static void bg_jump_time_mode(bg_time_mode_t time_mode);
+
 void bg_init(void)
 {
     assert(!bg.initialized);
@@ -125,32 +155,43 @@ void bg_init(void)
     for (size_t i = 0; i < BG_SPRITES_COUNT; i++)
     {
         bg.sprites[i] = sprite_load(BG_SPRITE_FILES[i]);
+        if (BG_SPRITE_PALETTES[i])
+        {
+            /* Only the precomputed fade ramp is kept around */
+            palette_t *const palette = palette_load(BG_SPRITE_PALETTES[i]);
+            assert(palette->variants == BG_TIME_MODES_COUNT);
+            bg.palettes[i] = palette_make_ramp(palette, BG_TIME_RAMP_STEPS);
+            palette_free(palette);
+        }
     }
     bg.sky_fill = (bg_fill_color_t){
         .y = BG_SKY_FILL_Y,
         .h = BG_SKY_FILL_H,
     };
     bg.cloud_top = (bg_fill_sprite_t){
+        .sprite = BG_SPRITE_CLOUD,
         .y = BG_CLOUD_TOP_Y,
         .scroll_x = 0,
         .scroll_dx = BG_SKY_SCROLL_DX,
-        .scroll_w = bg.sprites[BG_SPRITE_CLOUD_DAY]->width,
+        .scroll_w = bg.sprites[BG_SPRITE_CLOUD]->width,
     };
     bg.cloud_fill = (bg_fill_color_t){
         .y = BG_CLOUD_FILL_Y,
         .h = BG_CLOUD_FILL_H,
     };
     bg.city = (bg_fill_sprite_t){
+        .sprite = BG_SPRITE_CITY,
         .y = BG_CITY_TOP_Y,
         .scroll_x = 0,
         .scroll_dx = BG_CITY_SCROLL_DX,
-        .scroll_w = bg.sprites[BG_SPRITE_CITY_DAY]->width,
+        .scroll_w = bg.sprites[BG_SPRITE_CITY]->width,
     };
     bg.hill_top = (bg_fill_sprite_t){
+        .sprite = BG_SPRITE_HILL,
         .y = BG_HILL_TOP_Y,
         .scroll_x = 0,
         .scroll_dx = BG_HILL_SCROLL_DX,
-        .scroll_w = bg.sprites[BG_SPRITE_HILL_DAY]->width,
+        .scroll_w = bg.sprites[BG_SPRITE_HILL]->width,
     };
     bg.hill_fill = (bg_fill_color_t){
         .y = BG_HILL_FILL_Y, .h = BG_HILL_FILL_H};
@@ -166,7 +207,7 @@ void bg_init(void)
         .y = BG_GROUND_FILL_Y,
         .h = BG_GROUND_FILL_H,
     };
-    bg_set_time_mode(BG_TIME_DAY);
+    bg_jump_time_mode(BG_TIME_DAY);
 }
 
 bg_time_mode_t bg_get_time_mode(void)
@@ -174,27 +215,47 @@ bg_time_mode_t bg_get_time_mode(void)
     return bg.time_mode;
 }
 
+static color_t bg_lerp_color(color_t a, color_t b, float t)
+{
+    return RGBA32(
+        a.r + (b.r - a.r) * t,
+        a.g + (b.g - a.g) * t,
+        a.b + (b.b - a.b) * t,
+        a.a + (b.a - a.a) * t);
+}
+
+static color_t bg_time_color(const color_t colors[BG_TIME_MODES_COUNT], float pos)
+{
+    const int mode = pos;
+    const float t = pos - mode;
+    if (mode >= BG_TIME_MODES_COUNT - 1) return colors[BG_TIME_MODES_COUNT - 1];
+    return bg_lerp_color(colors[mode], colors[mode + 1], t);
+}
+
+/* Recolor fills and pick the palette ramp row for a time of day */
+static void bg_apply_time_pos(float pos)
+{
+    bg.time_pos = pos;
+    bg.time_ramp_row = pos * BG_TIME_RAMP_STEPS + 0.5f;
+    bg.sky_fill.color = bg_time_color(BG_COLORS_SKY, pos);
+    bg.cloud_fill.color = bg_time_color(BG_COLORS_CLOUD, pos);
+    bg.hill_fill.color = bg_time_color(BG_COLORS_HILL, pos);
+}
+
+/* Switch without a fade, e.g. when the world resets */
+static void bg_jump_time_mode(bg_time_mode_t time_mode)
+{
+    bg.time_mode = time_mode;
+    bg.time_ticks = get_ticks();
+    bg_apply_time_pos(time_mode);
+}
+
 void bg_set_time_mode(bg_time_mode_t time_mode)
 {
+    /* bg_tick fades from the current time of day toward the new mode */
+    if (bg.time_mode == time_mode) return;
     bg.time_mode = time_mode;
-    if (time_mode == BG_TIME_DAY)
-    {
-        bg.sky_fill.color = BG_COLOR_DAY_SKY;
-        bg.cloud_fill.color = BG_COLOR_DAY_CLOUD;
-        bg.hill_fill.color = BG_COLOR_DAY_HILL;
-        bg.cloud_top.sprite = BG_SPRITE_CLOUD_DAY;
-        bg.city.sprite = BG_SPRITE_CITY_DAY;
-        bg.hill_top.sprite = BG_SPRITE_HILL_DAY;
-    }
-    else if (time_mode == BG_TIME_NIGHT)
-    {
-        bg.sky_fill.color = BG_COLOR_NIGHT_SKY;
-        bg.cloud_fill.color = BG_COLOR_NIGHT_CLOUD;
-        bg.hill_fill.color = BG_COLOR_NIGHT_HILL;
-        bg.cloud_top.sprite = BG_SPRITE_CLOUD_NIGHT;
-        bg.city.sprite = BG_SPRITE_CITY_NIGHT;
-        bg.hill_top.sprite = BG_SPRITE_HILL_NIGHT;
-    }
+    bg.time_ticks = get_ticks();
 }
 
 static inline bg_time_mode_t bg_random_time_mode(void)
@@ -204,7 +265,30 @@ static inline bg_time_mode_t bg_random_time_mode(void)
 
 void bg_randomize_time_mode(void)
 {
-    bg_set_time_mode(bg_random_time_mode());
+    bg_jump_time_mode(bg_random_time_mode());
+}
+
+static void bg_tick_time(void)
+{
+    const uint64_t now_ticks = get_ticks();
+    const float target = bg.time_mode;
+    float pos = bg.time_pos;
+    if (pos != target)
+    {
+        const float step = (float)(now_ticks - bg.time_ticks) / BG_TIME_FADE_TICKS;
+        if (pos < target)
+        {
+            pos += step;
+            if (pos > target) pos = target;
+        }
+        else
+        {
+            pos -= step;
+            if (pos < target) pos = target;
+        }
+        bg_apply_time_pos(pos);
+    }
+    bg.time_ticks = now_ticks;
 }
 
 void bg_tick_scroll(bg_fill_sprite_t *fill)
@@ -217,6 +301,107 @@ void bg_tick_scroll(bg_fill_sprite_t *fill)
     fill->scroll_x = x;
 }
 
+static void bg_bake_fill(const panel_t *strip, const color_t colors[BG_TIME_MODES_COUNT],
+    bg_time_mode_t mode, int y, int h)
+{
+    /* rdpq clips the fill to the strip */
+    rdpq_set_mode_fill(colors[mode]);
+    rdpq_fill_rectangle(0, GFX_SCALE_Y(y) - strip->y, strip->surface.width,
+        GFX_SCALE_Y(y + h) - strip->y);
+}
+
+static void bg_bake_sprite(const panel_t *strip, const bg_fill_sprite_t *fill, bg_time_mode_t mode)
+{
+    sprite_t *const sprite = bg.sprites[fill->sprite];
+    surface_t pixels = palette_index_surface(sprite);
+    rdpq_set_mode_standard();
+    rdpq_mode_alphacompare(1);
+    palette_upload(bg.palettes[fill->sprite], mode * BG_TIME_RAMP_STEPS);
+    rdpq_tex_upload(TILE0, &pixels, NULL);
+    const int y = GFX_SCALE_Y(fill->y) - strip->y;
+    rdpq_texture_rectangle_scaled(TILE0,
+        0, y, GFX_SCALE_X(pixels.width), y + GFX_SCALE_Y(pixels.height),
+        0, 0, pixels.width, pixels.height);
+}
+
+/*
+ * Each band is one scrolling layer plus the color fills behind it, one
+ * sprite period wide. Fills are only baked where nothing that scrolls at
+ * another rate shows through; elsewhere the band stays transparent, so
+ * drawing the bands back to front matches the layered draw exactly.
+ */
+static bool bg_bake_band(bg_band_t band, bg_time_mode_t mode)
+{
+    static const int BAND_Y[BG_BANDS_COUNT + 1] = {
+        [BG_BAND_CLOUD] = BG_CLOUD_TOP_Y,
+        [BG_BAND_CITY] = BG_CITY_TOP_Y,
+        [BG_BAND_HILL] = BG_HILL_TOP_Y,
+        [BG_BANDS_COUNT] = BG_GROUND_TOP_Y_BASE,
+    };
+    const bg_fill_sprite_t *const layers[BG_BANDS_COUNT] = {
+        [BG_BAND_CLOUD] = &bg.cloud_top,
+        [BG_BAND_CITY] = &bg.city,
+        [BG_BAND_HILL] = &bg.hill_top,
+    };
+    const bg_fill_sprite_t *const layer = layers[band];
+    const int layer_bottom = layer->y + bg.sprites[layer->sprite]->height;
+    const int bottom = (band == BG_BAND_CITY) ? layer_bottom : BAND_Y[band + 1];
+    const panel_rect_t rect = {
+        .x0 = 0,
+        .y0 = GFX_SCALE_Y(BAND_Y[band]),
+        .x1 = GFX_SCALE_X(layer->scroll_w),
+        .y1 = GFX_SCALE_Y(bottom),
+    };
+    panel_t *const strip = &bg.bands[band][mode];
+    if (!panel_begin(strip, &rect)) return false;
+    switch (band)
+    {
+    case BG_BAND_CLOUD:
+        bg_bake_fill(strip, BG_COLORS_SKY, mode, BG_SKY_FILL_Y, BG_SKY_FILL_H);
+        bg_bake_fill(strip, BG_COLORS_CLOUD, mode, BG_CLOUD_FILL_Y, BG_CLOUD_FILL_H);
+        break;
+    case BG_BAND_CITY:
+        bg_bake_fill(strip, BG_COLORS_CLOUD, mode, BG_CLOUD_FILL_Y, BG_CLOUD_FILL_H);
+        break;
+    case BG_BAND_HILL:
+        bg_bake_fill(strip, BG_COLORS_HILL, mode, BG_HILL_FILL_Y, BG_HILL_FILL_H);
+        break;
+    default:
+        break;
+    }
+    bg_bake_sprite(strip, layer, mode);
+    panel_end(strip);
+    return true;
+}
+
+static inline bool bg_is_baked(void)
+{
+    return bg.baked && bg.baked_scale_x == gfx->scale_x && bg.baked_scale_y == gfx->scale_y;
+}
+
+/*
+ * Rebake every band when the resolution changes. Bands that could not be
+ * allocated are retried on later ticks; until all of them exist the sky is
+ * drawn live, as it is between time modes.
+ */
+static void bg_tick_bake(void)
+{
+    if (bg_is_baked()) return;
+    const bool rescaled = bg.baked_scale_x != gfx->scale_x || bg.baked_scale_y != gfx->scale_y;
+    bool baked = true;
+    for (int band = 0; band < BG_BANDS_COUNT; band++)
+    {
+        for (int mode = 0; mode < BG_TIME_MODES_COUNT; mode++)
+        {
+            if (!rescaled && panel_is_valid(&bg.bands[band][mode])) continue;
+            if (!bg_bake_band(band, mode)) baked = false;
+        }
+    }
+    bg.baked_scale_x = gfx->scale_x;
+    bg.baked_scale_y = gfx->scale_y;
+    bg.baked = baked;
+}
+
 void bg_tick(const joypad_buttons_t *buttons)
 {
     /* Switch between day and night */
@@ -224,11 +409,13 @@ void bg_tick(const joypad_buttons_t *buttons)
     {
         bg_set_time_mode(!bg.time_mode);
     }
+    bg_tick_time();
+    bg_tick_bake();
     /* Scroll the bg */
     const uint64_t now_ticks = get_ticks();
-    if ((now_ticks - bg.scroll_ticks) >= BG_SCROLL_RATE)
+    int steps = pace_steps(&bg.scroll_ticks, now_ticks, BG_SCROLL_RATE);
+    for (; steps > 0; steps--)
     {
-        bg.scroll_ticks = now_ticks;
         bg_tick_scroll(&bg.cloud_top);
         bg_tick_scroll(&bg.city);
         bg_tick_scroll(&bg.hill_top);
@@ -239,14 +426,15 @@ void bg_tick(const joypad_buttons_t *buttons)
 static void bg_draw_color(const bg_fill_color_t * const fill)
 {
     rdpq_set_mode_fill(fill->color);
-    const int tx = 0, ty = GFX_SCALE(fill->y);
-    const int bx = gfx->width, by = GFX_SCALE(fill->y + fill->h);
+    const int tx = 0, ty = GFX_SCALE_Y(fill->y);
+    const int bx = gfx->width, by = GFX_SCALE_Y(fill->y + fill->h);
     rdpq_fill_rectangle(tx, ty, bx, by);
 }
 
 static void bg_draw_sprite(const bg_fill_sprite_t *const fill)
 {
     sprite_t *sprite = bg.sprites[fill->sprite];
+    const palette_t *palette = bg.palettes[fill->sprite];
     assert(sprite != NULL);
     assert(sprite->hslices == 1);
     assert(sprite->vslices == 1);
@@ -259,8 +447,8 @@ static void bg_draw_sprite(const bg_fill_sprite_t *const fill)
     const int tex_h = sprite->height;
 
     /* Screen coordinates (scaled) */
-    const int scr_ty = GFX_SCALE(fill->y);
-    const int scr_by = scr_ty + GFX_SCALE(tex_h);
+    const int scr_ty = GFX_SCALE_Y(fill->y);
+    const int scr_by = scr_ty + GFX_SCALE_Y(tex_h);
     const int scr_max_w = gfx->width;
 
     /* Upload sprite with horizontal tiling */
@@ -268,10 +456,20 @@ static void bg_draw_sprite(const bg_fill_sprite_t *const fill)
         .s = { .repeats = REPEAT_INFINITE, .mirror = MIRROR_NONE },
         .t = { .repeats = 1, .mirror = MIRROR_NONE },
     };
-    rdpq_sprite_upload(TILE0, sprite, &tiled_texparams);
+    if (palette)
+    {
+        /* The time of day only changes which TLUT row gets loaded */
+        surface_t pixels = palette_index_surface(sprite);
+        palette_upload(palette, bg.time_ramp_row);
+        rdpq_tex_upload(TILE0, &pixels, &tiled_texparams);
+    }
+    else
+    {
+        rdpq_sprite_upload(TILE0, sprite, &tiled_texparams);
+    }
 
     /* Calculate screen X start based on scroll, handling wrap */
-    int scr_tx = GFX_SCALE(scroll_x);
+    int scr_tx = GFX_SCALE_X(scroll_x);
     float tex_s0 = 0;
     if (scr_tx < 0) {
         /* Left edge clipped - adjust texture start coordinate */
@@ -280,14 +478,40 @@ static void bg_draw_sprite(const bg_fill_sprite_t *const fill)
     }
 
     /* Draw with hardware tiling - texture repeats automatically */
-    float tex_s1 = tex_s0 + (scr_max_w - scr_tx) / gfx->scale;
+    float tex_s1 = tex_s0 + (scr_max_w - scr_tx) / gfx->scale_x;
     rdpq_texture_rectangle_scaled(TILE0,
         scr_tx, scr_ty, scr_max_w, scr_by,
         tex_s0, 0, tex_s1, tex_h);
 }
 
+static void bg_draw_band(const panel_t *strip, const bg_fill_sprite_t *fill)
+{
+    if (!panel_is_valid(strip)) return;
+    const int w = strip->surface.width;
+    /* Start at or left of the screen edge and repeat across it */
+    int x = GFX_SCALE_X(fill->scroll_x) % w;
+    if (x > 0) x -= w;
+    for (; x < gfx->width; x += w)
+    {
+        rdpq_tex_blit(&strip->surface, x, strip->y, NULL);
+    }
+}
+
 void bg_draw_sky(void)
 {
+    /* Layers are drawn live between time modes and while any band is missing */
+    if (bg_is_baked() && bg.time_pos == (float)bg.time_mode)
+    {
+        rdpq_set_mode_fill(bg.sky_fill.color);
+        rdpq_fill_rectangle(0, GFX_SCALE_Y(BG_SKY_FILL_Y), gfx->width, GFX_SCALE_Y(BG_CLOUD_TOP_Y));
+        /* 1:1 copies with alpha compare */
+        rdpq_set_mode_copy(true);
+        bg_draw_band(&bg.bands[BG_BAND_CLOUD][bg.time_mode], &bg.cloud_top);
+        bg_draw_band(&bg.bands[BG_BAND_CITY][bg.time_mode], &bg.city);
+        bg_draw_band(&bg.bands[BG_BAND_HILL][bg.time_mode], &bg.hill_top);
+        return;
+    }
+
     /* Color fills (sky, clouds, hills - but not ground) */
     bg_draw_color(&bg.sky_fill);
     bg_draw_color(&bg.cloud_fill);
@@ -15,7 +15,7 @@
 /* Background constants */
 
 #define BG_GROUND_TOP_Y_BASE    ((int)190)
-#define BG_GROUND_TOP_Y         GFX_SCALE(BG_GROUND_TOP_Y_BASE)
+#define BG_GROUND_TOP_Y         GFX_SCALE_Y(BG_GROUND_TOP_Y_BASE)
 
 /* Background types */
 
@@ -15,6 +15,9 @@
 #include "gfx.h"
 #include "sfx.h"
 #include "bg.h"
+#include "input.h"
+#include "pace.h"
+#include "rdpmon.h"
 
 /* Bird definitions */
 
@@ -52,15 +55,123 @@
 #define BIRD_ROTATION_DOWN_MS   600
 #define BIRD_ROTATION_HOLD_MS   300
 
+/* Pre-rotated frames: 5 degree buckets land exactly on 0, UP and DOWN */
+#define BIRD_ROTATION_STEP_DEG  ((float) (5.0 * M_PI / 180.0))
+#define BIRD_ROTATION_BUCKETS   ((int) ((BIRD_ROTATION_UP_DEG - BIRD_ROTATION_DOWN_DEG) / BIRD_ROTATION_STEP_DEG + 1.5f))
+#define BIRD_ROTATION_SAMPLES   4
+
 /* Bird implementation */
 
+static int bird_index_at(const surface_t *pixels, int x, int y)
+{
+    const uint8_t *row = (const uint8_t *)pixels->buffer + y * pixels->stride;
+    return (x & 1) ? (row[x / 2] & 0xF) : (row[x / 2] >> 4);
+}
+
+/* Opaque texels of a cell, plus a transparent border for bilinear filtering */
+static bird_bounds_t bird_opaque_bounds(const surface_t *pixels, int cell_x, int cell_y, int cell)
+{
+    int x0 = cell, y0 = cell, x1 = 0, y1 = 0;
+    for (int y = 0; y < cell; y++)
+    {
+        for (int x = 0; x < cell; x++)
+        {
+            if (bird_index_at(pixels, cell_x + x, cell_y + y) == 0) continue;
+            if (x < x0) x0 = x;
+            if (x >= x1) x1 = x + 1;
+            if (y < y0) y0 = y;
+            if (y >= y1) y1 = y + 1;
+        }
+    }
+    assert(x0 < x1);
+    if (x0 > 0) x0--;
+    if (y0 > 0) y0--;
+    if (x1 < cell) x1++;
+    if (y1 < cell) y1++;
+    return (bird_bounds_t){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+/*
+ * Rotate every animation frame into each angle bucket on the CPU, once.
+ * Texels stay palette indices (the most common index among 4x4
+ * subsamples), so the cache is shared by every bird color and drawing is a
+ * texture rectangle over just the opaque part of the cell.
+ */
+static void bird_build_rotated(bird_t *bird)
+{
+    const int frame_w = bird->slice_w;
+    const int frame_h = bird->slice_h;
+    const int frames = bird->sprite->hslices;
+    const int cell = ((int)ceilf(sqrtf(frame_w * frame_w + frame_h * frame_h)) + 1) & ~1;
+    const int width = frames * cell;
+    assert(surface_get_format(&bird->pixels) == FMT_CI4);
+    bird->rotated_cell = cell;
+    bird->rotated = surface_alloc(FMT_CI4, width, BIRD_ROTATION_BUCKETS * cell);
+    bird->rotated_bounds = malloc(BIRD_ROTATION_BUCKETS * frames * sizeof(bird_bounds_t));
+    uint8_t *const row = malloc(bird->rotated.stride);
+
+    for (int bucket = 0; bucket < BIRD_ROTATION_BUCKETS; bucket++)
+    {
+        const float theta = BIRD_ROTATION_DOWN_DEG + bucket * BIRD_ROTATION_STEP_DEG;
+        const float sin_theta = sinf(theta);
+        const float cos_theta = cosf(theta);
+        for (int y = 0; y < cell; y++)
+        {
+            memset(row, 0, bird->rotated.stride);
+            for (int x = 0; x < width; x++)
+            {
+                const int frame = x / cell;
+                int counts[16] = {0};
+                int best = 0;
+                for (int sy = 0; sy < BIRD_ROTATION_SAMPLES; sy++)
+                for (int sx = 0; sx < BIRD_ROTATION_SAMPLES; sx++)
+                {
+                    /* Inverse rotation about the cell and frame centers */
+                    const float dx = (x % cell) + (sx + 0.5f) / BIRD_ROTATION_SAMPLES - cell / 2;
+                    const float dy = y + (sy + 0.5f) / BIRD_ROTATION_SAMPLES - cell / 2;
+                    const float u = dx * cos_theta - dy * sin_theta + frame_w / 2;
+                    const float v = dx * sin_theta + dy * cos_theta + frame_h / 2;
+                    int idx = 0;
+                    if (u >= 0 && v >= 0 && u < frame_w && v < frame_h)
+                    {
+                        idx = bird_index_at(&bird->pixels, frame * frame_w + (int)u, (int)v);
+                    }
+                    if (++counts[idx] > counts[best]) best = idx;
+                }
+                row[x / 2] |= (x & 1) ? best : best << 4;
+            }
+            memcpy((uint8_t *)bird->rotated.buffer + (bucket * cell + y) * bird->rotated.stride,
+                   row, bird->rotated.stride);
+        }
+        for (int frame = 0; frame < frames; frame++)
+        {
+            bird->rotated_bounds[bucket * frames + frame] = bird_opaque_bounds(&bird->rotated,
+                frame * cell, bucket * cell, cell);
+        }
+    }
+    free(row);
+}
+
+static int bird_rotation_bucket(float rotation)
+{
+    const int bucket = lroundf((rotation - BIRD_ROTATION_DOWN_DEG) / BIRD_ROTATION_STEP_DEG);
+    if (bucket < 0) return 0;
+    if (bucket >= BIRD_ROTATION_BUCKETS) return BIRD_ROTATION_BUCKETS - 1;
+    return bucket;
+}
+
 bird_t *bird_init(bird_color_t color_type)
 {
     sprite_t *const sprite = sprite_load("rom:/gfx/bird.sprite");
     bird_t *const bird = malloc(sizeof(bird_t));
     bird->sprite = sprite;
+    /* Colors are TLUT rows over a single copy of the animation frames */
+    bird->palette = palette_load("bird");
+    assert(bird->palette->variants >= BIRD_COLORS_COUNT);
+    bird->pixels = palette_index_surface(sprite);
     bird->slice_w = sprite->width / sprite->hslices;
     bird->slice_h = sprite->height / sprite->vslices;
+    bird_build_rotated(bird);
     bird->state = BIRD_STATE_TITLE;
     bird->color_type = color_type;
     bird->score = 0;
@@ -88,32 +199,17 @@ void bird_free(bird_t *bird)
 {
     sprite_free(bird->sprite);
     bird->sprite = NULL;
+    palette_free(bird->palette);
+    bird->palette = NULL;
+    surface_free(&bird->rotated);
+    free(bird->rotated_bounds);
     free(bird);
 }
 
-void bird_draw(const bird_t *bird)
+#ifdef FLAPPY_BENCHMARK
+/* Rotated blit of the source frame; what bird_draw did before the cache */
+static void bird_draw_rotated_blit(const bird_t *bird, float x, float y)
 {
-    /* Calculate player space center position */
-    const int cx = gfx->width * bird->x;
-    const int cy = BG_GROUND_TOP_Y / 2;
-    /* Calculate bird Y position */
-    float bird_y = bird->y;
-    switch (bird->state)
-    {
-    case BIRD_STATE_READY:
-    case BIRD_STATE_TITLE:
-        bird_y += bird->sine_y;
-        break;
-    default:
-        break;
-    }
-    if (bird_y > BIRD_MAX_Y) bird_y = BIRD_MAX_Y;
-    if (bird_y < BIRD_MIN_Y) bird_y = BIRD_MIN_Y;
-    bird_y = cy + bird_y * cy;
-    /* Calculate texture offset for current animation frame and color */
-    const int s_offset = bird->anim_frame * bird->slice_w;
-    const int t_offset = bird->color_type * bird->slice_h;
-    /* Draw the bird sprite with rotation */
     rdpq_set_mode_standard();
     if (bird->rotation != 0.0f && bird->rotation != BIRD_ROTATION_DOWN_DEG)
     {
@@ -125,19 +221,80 @@ void bird_draw(const bird_t *bird)
     {
         rdpq_mode_alphacompare(1);
     }
-    rdpq_sprite_blit(bird->sprite, cx, bird_y, &(rdpq_blitparms_t){
-        .s0 = s_offset,
-        .t0 = t_offset,
+    palette_upload(bird->palette, bird->color_type);
+    rdpq_tex_blit(&bird->pixels, x, y, &(rdpq_blitparms_t){
+        .s0 = bird->anim_frame * bird->slice_w,
         .width = bird->slice_w,
         .height = bird->slice_h,
         .cx = bird->slice_w / 2,
         .cy = bird->slice_h / 2,
         .theta = bird->rotation,
-        .scale_x = gfx->scale,
-        .scale_y = gfx->scale,
+        .scale_x = gfx->scale_x,
+        .scale_y = gfx->scale_y,
         .filtering = gfx->highres,
     });
 }
+#endif
+
+/*
+ * Axis-aligned blit of the opaque part of the nearest pre-rotated frame.
+ * Scaled up in high resolution, tilted frames are filtered and blended the
+ * way the rotated blit was; drawn 1:1 the filter would only sample texel
+ * centers, so they keep the hard edges of the level bird instead.
+ */
+static void bird_draw_cached(const bird_t *bird, float x, float y)
+{
+    const int cell = bird->rotated_cell;
+    const int bucket = bird_rotation_bucket(bird->rotation);
+    const bird_bounds_t *const bounds =
+        &bird->rotated_bounds[bucket * bird->sprite->hslices + bird->anim_frame];
+    rdpq_set_mode_standard();
+    if (gfx->highres && bird->rotation != 0.0f && bird->rotation != BIRD_ROTATION_DOWN_DEG)
+    {
+        rdpq_mode_blender(RDPQ_BLENDER_MULTIPLY);
+        rdpq_mode_filter(FILTER_BILINEAR);
+    }
+    else
+    {
+        rdpq_mode_alphacompare(1);
+    }
+    /* The bird color is just which palette row is loaded */
+    palette_upload(bird->palette, bird->color_type);
+    rdpq_tex_blit(&bird->rotated, x, y, &(rdpq_blitparms_t){
+        .s0 = bird->anim_frame * cell + bounds->x,
+        .t0 = bucket * cell + bounds->y,
+        .width = bounds->width,
+        .height = bounds->height,
+        .cx = cell / 2 - bounds->x,
+        .cy = cell / 2 - bounds->y,
+        .scale_x = gfx->scale_x,
+        .scale_y = gfx->scale_y,
+        .filtering = gfx->highres,
+    });
+}
+
+void bird_draw(const bird_t *bird)
+{
+    /* Calculate player space center position */
+    const int cx = GFX_WORLD_X(bird->x);
+    const int cy = BG_GROUND_TOP_Y / 2;
+    /* Calculate bird Y position */
+    float bird_y = bird->y;
+    switch (bird->state)
+    {
+    case BIRD_STATE_READY:
+    case BIRD_STATE_TITLE:
+        bird_y += bird->sine_y;
+        break;
+    default:
+        break;
+    }
+    if (bird_y > BIRD_MAX_Y) bird_y = BIRD_MAX_Y;
+    if (bird_y < BIRD_MIN_Y) bird_y = BIRD_MIN_Y;
+    bird_y = cy + bird_y * cy;
+    /* The bird moves in fractions of a line, so it follows the field */
+    bird_draw_cached(bird, cx, bird_y + gfx_field_offset_y());
+}
 
 void bird_hit(bird_t *bird)
 {
@@ -169,8 +326,14 @@ static void bird_tick_animation(bird_t *bird)
 
 static void bird_tick_dx(bird_t *bird)
 {
+    /* The title bird stays centered however much of the world is visible */
+    if (bird->state == BIRD_STATE_TITLE)
+    {
+        bird->x = BIRD_TITLE_X * gfx_view_width();
+        return;
+    }
     /* Move the bird over if needed */
-    if (bird->state != BIRD_STATE_TITLE && bird->x > BIRD_PLAY_X)
+    if (bird->x > BIRD_PLAY_X)
     {
         bird->dx += BIRD_ACCEL_X;
         bird->x -= bird->dx;
@@ -201,19 +364,38 @@ static void bird_tick_sine_wave(bird_t *bird)
     }
 }
 
-static void bird_tick_velocity(bird_t *bird, const joypad_buttons_t *const buttons)
+/*
+ * Flaps when the player pressed A, for presses sampled up to `until_ticks`.
+ * Returns the index of the first edge left for a later step.
+ */
+static size_t bird_tick_flaps(bird_t *bird, const input_edge_t *edges, size_t count,
+                              size_t next, uint64_t until_ticks)
 {
-    /* Flap when the player presses A */
-    if (bird->state == BIRD_STATE_PLAY && buttons->a)
+    for (; next < count && edges[next].ticks <= until_ticks; next++)
     {
-        bird->dy = -BIRD_FLAP_VELOCITY;
-        bird->anim_frame = BIRD_ANIM_FRAMES - 1;
-        bird->flap_ticks = get_ticks();
-        sfx_play(SFX_WING);
+        if (bird->state == BIRD_STATE_PLAY && edges[next].pressed.a)
+        {
+            bird->dy = -BIRD_FLAP_VELOCITY;
+            bird->anim_frame = BIRD_ANIM_FRAMES - 1;
+            bird->flap_ticks = edges[next].ticks;
+            sfx_play(SFX_WING);
+        }
     }
+    return next;
+}
+
+static void bird_tick_velocity(bird_t *bird)
+{
+    const input_edge_t *edges;
+    const size_t edge_count = input_get_edges(&edges);
+    size_t next_edge = 0;
     const uint64_t now_ticks = get_ticks();
-    if ((now_ticks - bird->dy_ticks) >= BIRD_VELOCITY_RATE)
+    int steps = pace_steps(&bird->dy_ticks, now_ticks, BIRD_VELOCITY_RATE);
+    for (; steps > 0 && bird->state != BIRD_STATE_DEAD; steps--)
     {
+        /* Steps run one rate apart up to now; a flap lands on the first after it */
+        const uint64_t step_ticks = now_ticks - (steps - 1) * BIRD_VELOCITY_RATE;
+        next_edge = bird_tick_flaps(bird, edges, edge_count, next_edge, step_ticks);
         bird_tick_dx(bird);
         float y = bird->y;
         float dy = bird->dy;
@@ -238,8 +420,9 @@ static void bird_tick_velocity(bird_t *bird, const joypad_buttons_t *const butto
         }
         bird->y = y;
         bird->dy = dy;
-        bird->dy_ticks = now_ticks;
     }
+    /* Presses since the last step take effect from the next one */
+    bird_tick_flaps(bird, edges, edge_count, next_edge, now_ticks);
 }
 
 static void bird_tick_rotation(bird_t *bird)
@@ -358,7 +541,7 @@ void bird_tick(bird_t *bird, const joypad_buttons_t *const buttons)
         break;
     case BIRD_STATE_PLAY:
     case BIRD_STATE_DYING:
-        bird_tick_velocity(bird, buttons);
+        bird_tick_velocity(bird);
         break;
     default:
         break;
@@ -386,3 +569,52 @@ bird_color_t bird_get_color(const bird_t *bird)
 {
     return bird->color_type;
 }
+
+#ifdef FLAPPY_BENCHMARK
+#define BIRD_BENCHMARK_LOOPS    8
+
+typedef void (*bird_draw_fn_t)(const bird_t *bird, float x, float y);
+
+/* Draw every frame at every bucket angle offscreen and count RDP cycles */
+static void bird_benchmark_path(bird_t *bird, surface_t *target, bird_draw_fn_t draw,
+                                uint32_t *pipe_cycles, uint32_t *tmem_cycles)
+{
+    rspq_wait();
+    rdpmon_counters_clear();
+    rdpq_attach(target, NULL);
+    for (int loop = 0; loop < BIRD_BENCHMARK_LOOPS; loop++)
+    {
+        for (int bucket = 0; bucket < BIRD_ROTATION_BUCKETS; bucket++)
+        {
+            bird->rotation = BIRD_ROTATION_DOWN_DEG + bucket * BIRD_ROTATION_STEP_DEG;
+            for (int frame = 0; frame < bird->sprite->hslices; frame++)
+            {
+                bird->anim_frame = frame;
+                draw(bird, target->width / 2, target->height / 2);
+            }
+        }
+    }
+    rdpq_detach_wait();
+    const rdpmon_counters_t counters = rdpmon_counters_read();
+    *pipe_cycles = counters.pipe_busy;
+    *tmem_cycles = counters.tmem;
+}
+
+void bird_benchmark(bird_t *bird)
+{
+    const float rotation = bird->rotation;
+    const int anim_frame = bird->anim_frame;
+    surface_t target = surface_alloc(FMT_RGBA16, bird->rotated_cell * 2, bird->rotated_cell * 2);
+    uint32_t pipe_rotated, tmem_rotated, pipe_cached, tmem_cached;
+    bird_benchmark_path(bird, &target, bird_draw_rotated_blit, &pipe_rotated, &tmem_rotated);
+    bird_benchmark_path(bird, &target, bird_draw_cached, &pipe_cached, &tmem_cached);
+    const int draws = BIRD_BENCHMARK_LOOPS * BIRD_ROTATION_BUCKETS * bird->sprite->hslices;
+    debugf("[BENCH] bird rotated blit: %lu pipe / %lu tmem RDP cycles per draw\n",
+           pipe_rotated / draws, tmem_rotated / draws);
+    debugf("[BENCH] bird cached frame: %lu pipe / %lu tmem RDP cycles per draw\n",
+           pipe_cached / draws, tmem_cached / draws);
+    surface_free(&target);
+    bird->rotation = rotation;
+    bird->anim_frame = anim_frame;
+}
+#endif
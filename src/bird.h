@@ -12,6 +12,8 @@
 
 #include <libdragon.h>
 
+#include "palette.h"
+
 /* Bird definitions */
 
 typedef enum
@@ -28,15 +30,30 @@ typedef enum
     BIRD_COLOR_YELLOW,
     BIRD_COLOR_RED,
     BIRD_COLOR_BLUE,
-    // Additional colors go above this line
+    // Additional colors go above this line (as TLUT rows; see variants= in manifest.txt)
     BIRD_COLORS_COUNT, // Not a color; just a count
 } bird_color_t;
 
+/* Opaque texels of one pre-rotated frame, relative to its cell */
+typedef struct bird_bounds_s
+{
+    uint8_t x;
+    uint8_t y;
+    uint8_t width;
+    uint8_t height;
+} bird_bounds_t;
+
 typedef struct bird_s
 {
     sprite_t *sprite;
+    palette_t *palette;
+    surface_t pixels;
     int slice_w;
     int slice_h;
+    /* Frames pre-rotated into angle buckets (one row per bucket) */
+    surface_t rotated;
+    int rotated_cell;
+    bird_bounds_t *rotated_bounds; // One per frame per bucket
     bird_state_t state;
     bird_color_t color_type;
     uint64_t hit_ticks;
@@ -79,4 +96,8 @@ void bird_set_color(bird_t *bird, bird_color_t color);
 
 bird_color_t bird_get_color(const bird_t *bird);
 
+#ifdef FLAPPY_BENCHMARK
+void bird_benchmark(bird_t *bird);
+#endif
+
 #endif
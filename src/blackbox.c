@@ -0,0 +1,184 @@
+/**
+ * FlappyBird-N64 - blackbox.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "blackbox.h"
+
+#include "pace.h"
+#include "prof.h"
+#include "rdpmon.h"
+
+/* Black box definitions */
+
+/* Spread dumps over frames so the log writes don't cause hitches of their own */
+#define BLACKBOX_DUMP_LINES_PER_FRAME 8
+
+// This array must line up with blackbox_event_t
+static const char *const BLACKBOX_EVENT_NAMES[BLACKBOX_EVENTS_COUNT] = {
+    "save",
+    "display",
+    "reset",
+    "telem",
+};
+
+typedef struct blackbox_entry_s
+{
+    uint32_t frame;
+    uint32_t frame_us;
+    uint16_t scope_us[PROF_SCOPES_COUNT];
+    uint16_t rdp_busy_us;
+    uint16_t rdp_blocked_us;
+    uint8_t vblanks;
+    uint8_t bird_state;
+    uint16_t score;
+    uint32_t events;
+} blackbox_entry_t;
+
+typedef struct blackbox_s
+{
+    uint32_t frame;
+    uint32_t events;            // Raised during the frame being recorded
+    /* The last BLACKBOX_FRAMES frames; `next` is overwritten next */
+    blackbox_entry_t entries[BLACKBOX_FRAMES];
+    int next;
+    int count;
+    int missed;                 // Hitches while dumping or refilling
+    /* Frozen while dumping; `dumped` lines written so far */
+    bool dumping;
+    int dumped;
+} blackbox_t;
+
+/* Black box implementation */
+
+static blackbox_t blackbox = {0};
+
+static inline uint16_t blackbox_clamp16(uint32_t value)
+{
+    return (value < UINT16_MAX) ? value : UINT16_MAX;
+}
+
+void blackbox_event(blackbox_event_t event)
+{
+    blackbox.events |= 1 << event;
+}
+
+static uint32_t blackbox_get_threshold_us(void)
+{
+    if (FLAPPY_HITCH_US > 0) return FLAPPY_HITCH_US;
+    return TICKS_TO_US(pace_get_frame_ticks() * 3 / 2);
+}
+
+static void blackbox_dump_entry(const blackbox_entry_t *entry)
+{
+    char line[256];
+    int used = snprintf(line, sizeof(line), "[HITCH] %lu,%lu,%u,%u,%u,%u,%u",
+        (unsigned long)entry->frame, (unsigned long)entry->frame_us, entry->vblanks,
+        entry->bird_state, entry->score, entry->rdp_busy_us, entry->rdp_blocked_us);
+    /* Whatever the scopes don't cover, such as display switches */
+    uint32_t scoped_us = 0;
+    for (int scope = 0; scope < PROF_SCOPES_COUNT; scope++)
+    {
+        scoped_us += entry->scope_us[scope];
+        used += snprintf(&line[used], sizeof(line) - used, ",%u", entry->scope_us[scope]);
+    }
+    const uint32_t other_us = (entry->frame_us > scoped_us) ? entry->frame_us - scoped_us : 0;
+    used += snprintf(&line[used], sizeof(line) - used, ",%lu,", (unsigned long)other_us);
+    for (int event = 0; event < BLACKBOX_EVENTS_COUNT; event++)
+    {
+        if (!(entry->events & (1 << event))) continue;
+        used += snprintf(&line[used], sizeof(line) - used, "%s ", BLACKBOX_EVENT_NAMES[event]);
+    }
+    debugf("%s\n", line);
+}
+
+static void blackbox_dump_begin(const blackbox_entry_t *hitch)
+{
+    debugf("[HITCH] Frame %lu took %lu us (threshold %lu us); dumping %d frames, %d hitches missed\n",
+        (unsigned long)hitch->frame, (unsigned long)hitch->frame_us,
+        (unsigned long)blackbox_get_threshold_us(), blackbox.count, blackbox.missed);
+    char header[256];
+    int used = snprintf(header, sizeof(header),
+        "[HITCH] frame,frame_us,vblanks,bird_state,score,rdp_busy_us,rdp_blocked_us");
+    for (int scope = 0; scope < PROF_SCOPES_COUNT; scope++)
+    {
+        used += snprintf(&header[used], sizeof(header) - used, ",%s", prof_scope_name(scope));
+    }
+    snprintf(&header[used], sizeof(header) - used, ",other,events");
+    debugf("%s\n", header);
+    blackbox.dumping = true;
+    blackbox.dumped = 0;
+    blackbox.missed = 0;
+}
+
+/* Writes the next few frames, oldest first, and thaws once all are out */
+static void blackbox_dump_tick(void)
+{
+    const int oldest = (blackbox.next + BLACKBOX_FRAMES - blackbox.count) % BLACKBOX_FRAMES;
+    for (int line = 0; line < BLACKBOX_DUMP_LINES_PER_FRAME; line++)
+    {
+        if (blackbox.dumped == blackbox.count)
+        {
+            debugf("[HITCH] End of dump\n");
+            blackbox.dumping = false;
+            blackbox.count = 0;
+            return;
+        }
+        blackbox_dump_entry(&blackbox.entries[(oldest + blackbox.dumped) % BLACKBOX_FRAMES]);
+        blackbox.dumped++;
+    }
+}
+
+/*
+ * Records the frame prof_frame just closed; call after it and rdpmon_frame.
+ * A hitch freezes the history until it has been dumped, and the next dump
+ * waits for a full history again, so a run of slow frames logs once.
+ */
+void blackbox_frame(const bird_t *bird)
+{
+    const uint32_t frame = blackbox.frame++;
+    const uint32_t events = blackbox.events;
+    blackbox.events = 0;
+    const uint32_t frame_ticks = prof_get_last_frame_ticks();
+    if (frame_ticks == 0) return;
+
+    const uint32_t frame_us = TICKS_TO_US(frame_ticks);
+    const bool hitch = frame_us > blackbox_get_threshold_us();
+    if (blackbox.dumping)
+    {
+        if (hitch) blackbox.missed++;
+        blackbox_dump_tick();
+        return;
+    }
+
+    blackbox_entry_t *const entry = &blackbox.entries[blackbox.next];
+    const rdpmon_frame_t rdp = rdpmon_get_frame();
+    *entry = (blackbox_entry_t){
+        .frame = frame,
+        .frame_us = frame_us,
+        .rdp_busy_us = blackbox_clamp16(rdp.busy_us),
+        .rdp_blocked_us = blackbox_clamp16(rdp.blocked_us),
+        .vblanks = pace_get_frame_vblanks(),
+        .bird_state = bird->state,
+        .score = blackbox_clamp16(bird->score),
+        .events = events,
+    };
+    for (int scope = 0; scope < PROF_SCOPES_COUNT; scope++)
+    {
+        entry->scope_us[scope] = blackbox_clamp16(TICKS_TO_US(prof_get_last_ticks(scope)));
+    }
+    blackbox.next = (blackbox.next + 1) % BLACKBOX_FRAMES;
+    if (blackbox.count < BLACKBOX_FRAMES) blackbox.count++;
+
+    if (!hitch) return;
+    if (blackbox.count < BLACKBOX_FRAMES)
+    {
+        blackbox.missed++;
+        return;
+    }
+    blackbox_dump_begin(entry);
+}
@@ -0,0 +1,42 @@
+/**
+ * FlappyBird-N64 - blackbox.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_BLACKBOX_H
+#define __FLAPPY_BLACKBOX_H
+
+#include "system.h"
+#include "bird.h"
+
+/* Black box definitions */
+
+#define BLACKBOX_FRAMES 120 // Frames of history dumped with a hitch
+
+/* Frames longer than this are hitches; 0 means 1.5x the paced frame time */
+#ifndef FLAPPY_HITCH_US
+#define FLAPPY_HITCH_US 0
+#endif
+
+/* Things the game did that can explain a hitch */
+typedef enum
+{
+    BLACKBOX_EVENT_SAVE,
+    BLACKBOX_EVENT_DISPLAY,
+    BLACKBOX_EVENT_RESET,
+    BLACKBOX_EVENT_TELEM,
+    // Additional events go above this line
+    BLACKBOX_EVENTS_COUNT // Not an event; just a count
+} blackbox_event_t;
+
+/* Black box functions */
+
+void blackbox_event(blackbox_event_t event);
+
+void blackbox_frame(const bird_t *bird);
+
+#endif
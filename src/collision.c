@@ -21,7 +21,7 @@ void collision_tick(bird_t *bird, pipes_t *pipes)
 {
     pipe_t *pipe;
     const float bird_x = bird->x, bird_y = bird->y;
-    for (size_t i = 0; i < PIPES_MAX_COUNT; i++)
+    for (size_t i = 0; i < pipes->count; i++)
     {
         pipe = &pipes->n[i];
         const float pipe_x = pipe->x, pipe_y = pipe->y;
@@ -0,0 +1,67 @@
+/**
+ * FlappyBird-N64 - digits.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "digits.h"
+
+#include "gfx.h"
+
+/* Digits implementation */
+
+void digits_init(digits_t *digits)
+{
+    memset(digits, 0, sizeof *digits);
+    /* Force the first digits_set to decompose its value */
+    digits->value = -1;
+}
+
+void digits_set(digits_t *digits, int value)
+{
+    if (digits->value == value) return;
+    digits->value = value;
+    size_t i = 0;
+    do
+    {
+        digits->n[i++] = value % 10;
+        value /= 10;
+    } while (value != 0 && i < DIGITS_MAX_COUNT);
+    digits->count = i;
+}
+
+int digits_width(const digits_t *digits, const atlas_t *atlas, size_t font_id)
+{
+    const atlas_rect_t *const font = atlas_get_rect(atlas, ATLAS_PAGE_ALL, font_id);
+    return GFX_SCALE_X(atlas_rect_slice_w(font)) * digits->count;
+}
+
+/*
+ * Load the whole digits atlas (every font) into TILE0 in one go; any number
+ * of digits_draw calls can follow until something else uses TMEM.
+ */
+void digits_begin(const atlas_t *atlas)
+{
+    atlas_begin(atlas, ATLAS_PAGE_ALL);
+}
+
+/* One texture rectangle per digit, right-aligned at right_x */
+void digits_draw(const digits_t *digits, const atlas_t *atlas, size_t font_id, int right_x, int y)
+{
+    const atlas_rect_t *const font = atlas_get_rect(atlas, ATLAS_PAGE_ALL, font_id);
+    const int digit_w = atlas_rect_slice_w(font);
+    const int digit_h = atlas_rect_slice_h(font);
+    const int scaled_w = GFX_SCALE_X(digit_w);
+    const int scaled_h = GFX_SCALE_Y(digit_h);
+    int x = right_x - scaled_w;
+    for (size_t i = 0; i < digits->count; i++)
+    {
+        const int s0 = font->x + digits->n[i] * digit_w;
+        rdpq_texture_rectangle_scaled(TILE0, x, y, x + scaled_w, y + scaled_h,
+            s0, font->y, s0 + digit_w, font->y + digit_h);
+        x -= scaled_w;
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * FlappyBird-N64 - digits.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_DIGITS_H
+#define __FLAPPY_DIGITS_H
+
+#include "system.h"
+#include "atlas.h"
+
+/* Digits definitions */
+
+#define DIGITS_MAX_COUNT    ((size_t)5)
+
+/* A number split into digits; only recomputed when the value changes */
+typedef struct digits_s
+{
+    int value;
+    size_t count;
+    uint8_t n[DIGITS_MAX_COUNT]; /* Least significant first */
+} digits_t;
+
+/* Digits functions */
+
+void digits_init(digits_t *digits);
+
+void digits_set(digits_t *digits, int value);
+
+int digits_width(const digits_t *digits, const atlas_t *atlas, size_t font_id);
+
+void digits_begin(const atlas_t *atlas);
+
+void digits_draw(const digits_t *digits, const atlas_t *atlas, size_t font_id, int right_x, int y);
+
+#endif
@@ -7,14 +7,39 @@
  * LICENSE.txt file in the root directory of this source tree.
  */
 
+#include <math.h>
+
 #include "fps.h"
 
 #include "gfx.h"
+#include "latency.h"
+#include "pace.h"
+#include "prof.h"
+#include "rdpmon.h"
+#include "text.h"
 
 /* FPS definitions */
 
-#define FPS_MAX             ((unsigned int) (60))
-#define FPS_FRAME_TICKS     ((unsigned int) ((1000.0 / FPS_MAX) * TICKS_PER_MS))
+#define FPS_TEXT_TICKS      ((unsigned int) (250 * TICKS_PER_MS))
+
+/* Frame time histogram: 4 buckets per doubling from 1 ms, up to about 1 s */
+#define FPS_HIST_MIN_US         1000
+#define FPS_HIST_PER_OCTAVE     4
+#define FPS_HIST_BUCKETS        40
+#define FPS_HIST_VBLANKS        5   // Frames held for 1..4 vblanks, then longer
+
+typedef enum
+{
+    FPS_LINE_RATE,
+    FPS_LINE_TIME,
+    FPS_LINE_PACE,
+    FPS_LINE_RDP,
+    FPS_LINE_LATENCY,
+    FPS_LINE_OVERRUN,
+    FPS_LINE_PERCENTILES,
+    // Additional lines go above this line
+    FPS_LINES_COUNT, // Not an actual line, just a handy counter
+} fps_line_t;
 
 typedef struct fps_counter_s
 {
@@ -22,6 +47,15 @@ typedef struct fps_counter_s
     ticks_t frame_ticks;
     int total_frames;
     int total_misses;
+    /* Frame time distribution since boot */
+    int hist[FPS_HIST_BUCKETS];
+    int hist_vblanks[FPS_HIST_VBLANKS];
+    int hist_count;
+    int max_us;
+    int long_frames; // Shown for more than two vblanks
+    /* Overlay text is re-laid-out a few times a second, not every frame */
+    ticks_t text_ticks;
+    text_t lines[FPS_LINES_COUNT];
 } fps_counter_t;
 
 /* FPS implementation */
@@ -31,6 +65,10 @@ static fps_counter_t fps = {0};
 void fps_init(void)
 {
     memset(&fps, 0, sizeof fps);
+    for (size_t i = 0; i < FPS_LINES_COUNT; i++)
+    {
+        text_init(&fps.lines[i]);
+    }
     color_t color = RGBA32(0xFF, 0xFF, 0xFF, 0xFF);
     /* Setup font style for FPS text (both 1x and 2x fonts) */
     rdpq_font_t *font_1x = (rdpq_font_t *)rdpq_text_get_font(FONT_AT01);
@@ -45,6 +83,130 @@ void fps_init(void)
     }
 }
 
+static int fps_hist_bucket(int frame_us)
+{
+    if (frame_us <= FPS_HIST_MIN_US) return 0;
+    const int bucket = log2f((float)frame_us / FPS_HIST_MIN_US) * FPS_HIST_PER_OCTAVE;
+    return (bucket < FPS_HIST_BUCKETS) ? bucket : FPS_HIST_BUCKETS - 1;
+}
+
+/* Upper bound of a bucket, which is what its percentiles report */
+static int fps_hist_bucket_us(int bucket)
+{
+    return FPS_HIST_MIN_US * exp2f((float)(bucket + 1) / FPS_HIST_PER_OCTAVE);
+}
+
+static int fps_hist_percentile_us(int percent)
+{
+    if (fps.hist_count == 0) return 0;
+    const int rank = (fps.hist_count * percent + 99) / 100;
+    int seen = 0;
+    for (int bucket = 0; bucket < FPS_HIST_BUCKETS; bucket++)
+    {
+        seen += fps.hist[bucket];
+        if (seen >= rank)
+        {
+            const int bound_us = fps_hist_bucket_us(bucket);
+            return (bound_us < fps.max_us) ? bound_us : fps.max_us;
+        }
+    }
+    return fps.max_us;
+}
+
+static void fps_hist_tick(int frame_us, int vblanks)
+{
+    fps.hist[fps_hist_bucket(frame_us)]++;
+    const int held = (vblanks < FPS_HIST_VBLANKS) ? vblanks : FPS_HIST_VBLANKS;
+    if (held > 0) fps.hist_vblanks[held - 1]++;
+    if (vblanks > 2) fps.long_frames++;
+    if (frame_us > fps.max_us) fps.max_us = frame_us;
+    fps.hist_count++;
+}
+
+static void fps_hist_dump(void)
+{
+    debugf("[FPS] %d frames: p50 %d, p95 %d, p99 %d, max %d us; %d over 2 vblanks\n",
+        fps.hist_count, fps_hist_percentile_us(50), fps_hist_percentile_us(95),
+        fps_hist_percentile_us(99), fps.max_us, fps.long_frames);
+    for (int bucket = 0; bucket < FPS_HIST_BUCKETS; bucket++)
+    {
+        if (fps.hist[bucket] == 0) continue;
+        debugf("[FPS]   <= %6d us: %d\n", fps_hist_bucket_us(bucket), fps.hist[bucket]);
+    }
+    for (int held = 1; held <= FPS_HIST_VBLANKS; held++)
+    {
+        debugf("[FPS]   %d%s vblanks: %d\n", held,
+            (held == FPS_HIST_VBLANKS) ? "+" : "", fps.hist_vblanks[held - 1]);
+    }
+}
+
+static void fps_text_tick(ticks_t now_ticks)
+{
+    if (!fps.should_draw) return;
+
+    /* Refresh on a timer, or straight away if the resolution changed */
+    const int font_id = gfx_font_id();
+    if (fps.lines[0].font_id == font_id &&
+        now_ticks - fps.text_ticks < FPS_TEXT_TICKS)
+    {
+        return;
+    }
+    fps.text_ticks = now_ticks;
+
+    const text_parms_t parms = {0};
+    char line[TEXT_MAX_LENGTH];
+
+    snprintf(line, sizeof(line), "FPS: %05.2f, Frame: %u, Miss: %u",
+        display_get_fps(), fps.total_frames, fps.total_misses);
+    text_set(&fps.lines[FPS_LINE_RATE], font_id, &parms, line);
+
+    snprintf(line, sizeof(line), "Milli: %llu, Tick: %llu",
+        now_ticks / TICKS_PER_MS, now_ticks);
+    text_set(&fps.lines[FPS_LINE_TIME], font_id, &parms, line);
+
+    snprintf(line, sizeof(line), "Pace: %d Hz x%d, Late: %d, Err: %d us",
+        pace_get_hz(), gfx_get_buffers(), pace_get_late_frames(), pace_get_error_us());
+    text_set(&fps.lines[FPS_LINE_PACE], font_id, &parms, line);
+
+    const rdpmon_frame_t rdp = rdpmon_get_frame();
+    snprintf(line, sizeof(line), "RDP: %d/%d us, %d%s B, Block: %d us",
+        rdp.busy_us, rdp.clock_us, rdp.bytes, rdp.filled ? "+" : "", rdp.blocked_us);
+    text_set(&fps.lines[FPS_LINE_RDP], font_id, &parms, line);
+
+    const latency_stats_t latency = latency_get_stats();
+    if (!latency_get_enabled())
+    {
+        snprintf(line, sizeof(line), "Latency: C-down to measure");
+    }
+    else if (latency.count == 0)
+    {
+        snprintf(line, sizeof(line), "Latency: flap to measure");
+    }
+    else
+    {
+        snprintf(line, sizeof(line), "Latency: %d/%d/%d us (%d)",
+            latency.min_us, latency.mean_us, latency.max_us, latency.count);
+    }
+    text_set(&fps.lines[FPS_LINE_LATENCY], font_id, &parms, line);
+
+    prof_overrun_t overrun;
+    if (prof_get_overrun(&overrun))
+    {
+        snprintf(line, sizeof(line), "Over: #%d %d us, %s %d us",
+            overrun.frame, overrun.frame_us, prof_scope_name(overrun.worst), overrun.worst_us);
+    }
+    else
+    {
+        snprintf(line, sizeof(line), "Over: none");
+    }
+    text_set(&fps.lines[FPS_LINE_OVERRUN], font_id, &parms, line);
+
+    snprintf(line, sizeof(line), "p50/95/99/max: %d/%d/%d/%d us, >2vb: %d",
+        fps_hist_percentile_us(50), fps_hist_percentile_us(95),
+        fps_hist_percentile_us(99), fps.max_us, fps.long_frames);
+    text_set(&fps.lines[FPS_LINE_PERCENTILES], font_id, &parms, line);
+}
+
 void fps_tick(const joypad_buttons_t *buttons)
 {
     /* Toggle drawing flag on C-up */
@@ -53,17 +215,33 @@ void fps_tick(const joypad_buttons_t *buttons)
         fps.should_draw = !fps.should_draw;
     }
 
+    /* Dump the frame time histogram on C-left */
+    if (buttons->c_left)
+    {
+        fps_hist_dump();
+    }
+
     fps.total_frames++;
 
-    /* Track missed frames */
+    /*
+     * Count misses in whole vblanks from the VI interrupt: a frame held for
+     * longer than its paced interval cost every slot it covered. Timer
+     * deltas undercount these, since a late frame start shortens the next.
+     */
+    const int interval = pace_get_interval_vblanks();
+    const int vblanks = pace_get_frame_vblanks();
     const ticks_t now_ticks = timer_ticks();
-    const ticks_t frame_diff = now_ticks - fps.frame_ticks;
-    if (fps.total_frames > 1 && frame_diff > FPS_FRAME_TICKS)
+    if (fps.total_frames > 1)
     {
-        int frame_period_diff = frame_diff - FPS_FRAME_TICKS;
-        fps.total_misses += frame_period_diff / FPS_FRAME_TICKS;
+        if (vblanks > interval)
+        {
+            fps.total_misses += (vblanks - 1) / interval;
+        }
+        fps_hist_tick(TICKS_TO_US(now_ticks - fps.frame_ticks), vblanks);
     }
     fps.frame_ticks = now_ticks;
+
+    fps_text_tick(now_ticks);
 }
 
 void fps_set_visible(bool visible)
@@ -76,20 +254,25 @@ bool fps_get_visible(void)
     return fps.should_draw;
 }
 
+int fps_get_misses(void)
+{
+    return fps.total_misses;
+}
+
 void fps_draw(void)
 {
     if (!fps.should_draw) return;
 
-    const ticks_t ticks = timer_ticks();
-    const int font_id = gfx->highres ? FONT_AT01_2X : FONT_AT01;
-    const int margin_x = GFX_SCALE(10);
-    const int line_height = GFX_SCALE(14);
+    const int margin_x = GFX_SCALE_X(10);
+    const int line_height = GFX_SCALE_Y(14);
+    int y = gfx->height - (line_height * FPS_LINES_COUNT);
 
-    rdpq_text_printf(NULL, font_id, margin_x, gfx->height - (line_height * 2),
-        "FPS: %05.2f, Frame: %u, Miss: %u",
-        display_get_fps(), fps.total_frames, fps.total_misses);
+    /* Frame budget graph sits just above the text */
+    prof_draw(margin_x, y - GFX_SCALE_Y(4));
 
-    rdpq_text_printf(NULL, font_id, margin_x, gfx->height - (line_height * 1),
-        "Milli: %llu, Tick: %llu",
-        ticks / TICKS_PER_MS, ticks);
+    for (size_t i = 0; i < FPS_LINES_COUNT; i++)
+    {
+        text_draw(&fps.lines[i], margin_x, y, 0);
+        y += line_height;
+    }
 }
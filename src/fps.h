@@ -24,4 +24,6 @@ void fps_set_visible(bool visible);
 
 bool fps_get_visible(void);
 
+int fps_get_misses(void);
+
 #endif
@@ -9,70 +9,474 @@
 
 #include "gfx.h"
 
+#include "blackbox.h"
+#include "fps.h"
+#include "pace.h"
+#include "rdpmon.h"
+
+/* Automatic resolution */
+
+#define GFX_AUTO_WINDOW_FRAMES  60  // Misses are counted over about a second
+#define GFX_AUTO_SETTLE_FRAMES  10  // Ignore the hitch right after a switch
+#define GFX_AUTO_DOWN_MISSES    3   // Step down after this many in one window
+#define GFX_AUTO_UP_WINDOWS     5   // Clean windows before trying a tier up...
+#define GFX_AUTO_UP_WINDOWS_MAX 80  // ...doubling each time that fails
+
+static struct gfx_auto_s
+{
+    int frame;          // Negative while settling
+    int misses;         // fps miss total at the start of the window
+    int clean_windows;
+    int up_windows;
+    bool probing;       // Stepped up; the next window decides if it holds
+} gfx_auto = {0};
+
+/* Scan-out */
+
+/* VI registers, for the parts of scan-out libdragon has no calls for */
+#ifndef GFX_VI_REGS
+#define GFX_VI_REGS             ((volatile uint32_t *)0xA4400000)
+#endif
+#define GFX_VI_CTRL             (&GFX_VI_REGS[0])
+#define GFX_VI_ORIGIN           (&GFX_VI_REGS[1])
+#define GFX_VI_V_CURRENT        (&GFX_VI_REGS[4])
+#define GFX_VI_X_SCALE          (&GFX_VI_REGS[12])
+#define GFX_VI_CTRL_FILTERS     0x00010300  // De-dither enable and anti-alias mode
+#define GFX_VI_CTRL_RESAMPLE    0x00000200  // Anti-alias mode: resample only
+#define GFX_VI_X_SCALE_MASK     0x00000FFF
+
+/* How the VI shows one display buffer; set when a frame is locked into it */
+typedef struct gfx_scanout_s
+{
+    uint32_t start;     // Physical address range of the buffer
+    uint32_t end;
+    uint32_t stride;
+    int frame;          // The frame drawn into it
+    uint64_t shown_ticks; // When the VI first scanned it out, 0 until then
+    bool filters;       // VI anti-aliasing and de-dithering
+    bool half_width;    // 320 pixels per line
+    bool one_field;     // Both fields scan the even lines
+} gfx_scanout_t;
+
+static struct gfx_vi_s
+{
+    gfx_scanout_t scanouts[GFX_BUFFERS_MAX];
+    int frames;             // Frames locked so far
+    bool ready;             // display_init has run
+    bool interlaced;        // The shared 640x480 display, adjusted per buffer
+    bool throttled;         // Refused a frame for the buffer limit, still blocked
+    /* Written by the VI interrupt */
+    volatile bool captured;
+    volatile uint32_t ctrl; // VI_CTRL and VI_X_SCALE as display_init set them
+    volatile uint32_t x_scale;
+    volatile int shown_frame;
+    volatile int line_xor;  // Buffer line parity XOR VI field, as scanned out
+} gfx_vi = {0};
+
 gfx_t *gfx;
 
+/*
+ * Registered before display_init so that it runs after libdragon's own VI
+ * handler has pointed the VI at the buffer for this field. On the shared
+ * interlaced display, whatever that buffer was drawn for is applied on top,
+ * so a tier switch reaches the screen with the first buffer drawn after it
+ * and older queued buffers still show as they were drawn.
+ */
+static void gfx_vi_handler(void)
+{
+    if (!gfx_vi.ready) return;
+    if (gfx_vi.interlaced && !gfx_vi.captured)
+    {
+        gfx_vi.ctrl = *GFX_VI_CTRL;
+        gfx_vi.x_scale = *GFX_VI_X_SCALE;
+        gfx_vi.captured = true;
+    }
+    const uint32_t origin = *GFX_VI_ORIGIN;
+    for (int i = 0; i < GFX_BUFFERS_MAX; i++)
+    {
+        gfx_scanout_t *const scanout = &gfx_vi.scanouts[i];
+        if (origin < scanout->start || origin >= scanout->end) continue;
+        if (scanout->frame > gfx_vi.shown_frame)
+        {
+            gfx_vi.shown_frame = scanout->frame;
+            scanout->shown_ticks = get_ticks();
+        }
+        if (!gfx_vi.interlaced) return;
+        const uint32_t filters = scanout->filters ? (gfx_vi.ctrl & GFX_VI_CTRL_FILTERS) : GFX_VI_CTRL_RESAMPLE;
+        *GFX_VI_CTRL = (gfx_vi.ctrl & ~GFX_VI_CTRL_FILTERS) | filters;
+        const uint32_t x_scale = gfx_vi.x_scale & GFX_VI_X_SCALE_MASK;
+        *GFX_VI_X_SCALE = (gfx_vi.x_scale & ~GFX_VI_X_SCALE_MASK) |
+            (scanout->half_width ? x_scale / 2 : x_scale);
+        if (scanout->one_field)
+        {
+            *GFX_VI_ORIGIN = scanout->start;
+        }
+        else
+        {
+            const uint32_t line = (origin - scanout->start) / scanout->stride;
+            gfx_vi.line_xor = (line ^ *GFX_VI_V_CURRENT) & 1;
+        }
+        return;
+    }
+}
+
+static void gfx_scanout_set(const surface_t *disp, const gfx_scanout_t *scanout)
+{
+    const uint32_t start = PhysicalAddr(disp->buffer);
+    disable_interrupts();
+    for (int i = 0; i < GFX_BUFFERS_MAX; i++)
+    {
+        gfx_scanout_t *const slot = &gfx_vi.scanouts[i];
+        if (slot->start != start && slot->start != 0) continue;
+        *slot = *scanout;
+        slot->start = start;
+        slot->end = start + disp->stride * disp->height;
+        slot->stride = disp->stride;
+        break;
+    }
+    enable_interrupts();
+}
+
+/* Scale factors follow the framebuffer size and the aspect setting */
+static void gfx_update_scale(void)
+{
+    gfx->scale_x = (float)gfx->width / GFX_BASE_WIDTH;
+    if (gfx->widescreen)
+    {
+        gfx->scale_x *= GFX_WIDESCREEN_SQUEEZE;
+    }
+    gfx->scale_y = (float)gfx->height / GFX_BASE_HEIGHT;
+}
+
+/*
+ * Only switching between manual low resolution and the other modes
+ * reinitializes the display. Frames already queued for the old one are
+ * forgotten, so they cannot hold up the next lock.
+ */
+static void gfx_display_init(bool interlaced)
+{
+    gfx_vi.ready = false;
+    disable_interrupts();
+    memset(gfx_vi.scanouts, 0, sizeof gfx_vi.scanouts);
+    gfx_vi.shown_frame = gfx_vi.frames - 1;
+    gfx_vi.captured = false;
+    enable_interrupts();
+    gfx_vi.interlaced = interlaced;
+    if (interlaced)
+    {
+        /* VI anti-aliasing is turned off per buffer where not wanted */
+        display_init(RESOLUTION_640x480, DEPTH_16_BPP, GFX_BUFFERS_MAX, GAMMA_NONE,
+                     FILTERS_RESAMPLE_ANTIALIAS_DEDITHER);
+    }
+    else
+    {
+        display_init(RESOLUTION_320x240, DEPTH_16_BPP, GFX_BUFFERS_MAX, GAMMA_NONE,
+                     FILTERS_RESAMPLE);
+    }
+    gfx_vi.ready = true;
+}
+
+/* Switching tier only changes what the next frame locked draws into */
+static void gfx_set_tier(gfx_tier_t tier)
+{
+    gfx->tier = tier;
+    gfx->field = 0;
+    gfx->highres = (tier != GFX_TIER_LOW);
+    gfx->width = (tier == GFX_TIER_LOW) ? GFX_BASE_WIDTH : GFX_BASE_WIDTH * 2;
+    gfx->height = (tier >= GFX_TIER_MEDIUM) ? GFX_BASE_HEIGHT * 2 : GFX_BASE_HEIGHT;
+    gfx_update_scale();
+}
+
 void gfx_init(void)
 {
     /* Setup state */
     gfx = malloc(sizeof(gfx_t));
-    gfx->scale = 1.0f;
-    gfx->highres = false;
-    gfx->disp = NULL;
+    memset(gfx, 0, sizeof(gfx_t));
+    gfx->res_mode = GFX_RES_LOW;
+    gfx->target_tier = GFX_TIER_LOW;
+    gfx->buffers = GFX_BUFFERS_MAX;
+    gfx->target_buffers = GFX_BUFFERS_MAX;
+    gfx_auto.up_windows = GFX_AUTO_UP_WINDOWS;
     /* Set up the display and RDP subsystems */
-    display_init(RESOLUTION_320x240, DEPTH_16_BPP, 3, GAMMA_NONE, FILTERS_RESAMPLE);
+    register_VI_handler(gfx_vi_handler);
+    gfx_display_init(false);
+    gfx_set_tier(GFX_TIER_LOW);
     rdpq_init();
     /* Load custom fonts for text rendering (1x and 2x for high-res) */
     rdpq_font_t *font_1x = rdpq_font_load("rom:/fonts/at01-1x.font64");
     rdpq_font_t *font_2x = rdpq_font_load("rom:/fonts/at01-2x.font64");
     rdpq_text_register_font(FONT_AT01, font_1x);
     rdpq_text_register_font(FONT_AT01_2X, font_2x);
-    /* Cache display dimensions */
-    gfx->width = display_get_width();
-    gfx->height = display_get_height();
 }
 
+/*
+ * Switching resolution is only requested here; gfx_tick applies it at the
+ * top of the next frame so that a whole frame is simulated and drawn at
+ * one resolution, and so repeated toggles within a frame cost nothing.
+ */
 void gfx_set_highres(bool enable)
 {
-    if (gfx->highres == enable) return;
+    gfx_set_res_mode(enable ? GFX_RES_HIGH : GFX_RES_LOW);
+}
+
+bool gfx_get_highres(void)
+{
+    return gfx->target_tier != GFX_TIER_LOW;
+}
+
+void gfx_set_res_mode(gfx_res_mode_t mode)
+{
+    gfx->res_mode = mode;
+    switch (mode)
+    {
+    case GFX_RES_LOW:
+        gfx->target_tier = GFX_TIER_LOW;
+        break;
+    case GFX_RES_HIGH:
+        gfx->target_tier = GFX_TIER_HIGH;
+        break;
+    case GFX_RES_FIELD:
+        gfx->target_tier = GFX_TIER_FIELD;
+        break;
+    default:
+        /* Start from the current tier with a fresh window */
+        gfx_auto.frame = 0;
+        gfx_auto.clean_windows = 0;
+        gfx_auto.up_windows = GFX_AUTO_UP_WINDOWS;
+        gfx_auto.probing = false;
+        break;
+    }
+}
 
-    /* Wait for any pending RDP operations to complete */
-    rspq_wait();
+gfx_res_mode_t gfx_get_res_mode(void)
+{
+    return gfx->res_mode;
+}
 
-    /* Close the current display */
-    display_close();
+/* The VI output doesn't change; only what is drawn into it does */
+void gfx_set_widescreen(bool enable)
+{
+    gfx->target_widescreen = enable;
+}
 
-    /* Initialize with new resolution */
-    if (enable)
+bool gfx_get_widescreen(void)
+{
+    return gfx->target_widescreen;
+}
+
+/* Like a resolution switch, this takes effect from the next frame locked */
+void gfx_set_buffers(int buffers)
+{
+    assert(buffers >= GFX_BUFFERS_MIN && buffers <= GFX_BUFFERS_MAX);
+    gfx->target_buffers = buffers;
+}
+
+int gfx_get_buffers(void)
+{
+    return gfx->target_buffers;
+}
+
+/*
+ * Steps down a tier as soon as a window drops frames, and up again after
+ * enough clean windows. A step up that drops frames straight away doubles
+ * the wait before the next try, so a scene that is just over budget at a
+ * tier does not flip back and forth every few seconds.
+ */
+static void gfx_auto_tick(void)
+{
+    if (gfx->res_mode != GFX_RES_AUTO) return;
+
+    const int frame = gfx_auto.frame++;
+    if (frame < 0) return;
+    if (frame == 0)
     {
-        /* High-res: 640x480 interlaced with better filtering */
-        display_init(RESOLUTION_640x480, DEPTH_16_BPP, 3, GAMMA_NONE,
-                     FILTERS_RESAMPLE_ANTIALIAS_DEDITHER);
-        gfx->scale = 2.0f;
+        gfx_auto.misses = fps_get_misses();
+        return;
     }
-    else
+    if (frame < GFX_AUTO_WINDOW_FRAMES) return;
+
+    const int total_misses = fps_get_misses();
+    const int misses = total_misses - gfx_auto.misses;
+    gfx_auto.misses = total_misses;
+    gfx_auto.frame = 1;
+
+    if (misses >= GFX_AUTO_DOWN_MISSES)
     {
-        /* Low-res: 320x240 progressive */
-        display_init(RESOLUTION_320x240, DEPTH_16_BPP, 3, GAMMA_NONE,
-                     FILTERS_RESAMPLE);
-        gfx->scale = 1.0f;
+        if (gfx_auto.probing)
+        {
+            gfx_auto.up_windows *= 2;
+            if (gfx_auto.up_windows > GFX_AUTO_UP_WINDOWS_MAX)
+            {
+                gfx_auto.up_windows = GFX_AUTO_UP_WINDOWS_MAX;
+            }
+        }
+        gfx_auto.probing = false;
+        gfx_auto.clean_windows = 0;
+        if (gfx->target_tier > GFX_TIER_LOW)
+        {
+            gfx->target_tier--;
+        }
+        return;
     }
 
-    gfx->highres = enable;
-    gfx->width = display_get_width();
-    gfx->height = display_get_height();
+    if (gfx_auto.probing)
+    {
+        /* The new tier held, so the next step up need not wait as long */
+        gfx_auto.probing = false;
+        gfx_auto.up_windows = GFX_AUTO_UP_WINDOWS;
+    }
+    if (misses > 0)
+    {
+        gfx_auto.clean_windows = 0;
+        return;
+    }
+    if (++gfx_auto.clean_windows >= gfx_auto.up_windows &&
+        gfx->target_tier < GFX_TIERS_COUNT - 1)
+    {
+        gfx_auto.clean_windows = 0;
+        gfx_auto.probing = true;
+        gfx->target_tier++;
+    }
 }
 
-bool gfx_get_highres(void)
+void gfx_tick(void)
 {
-    return gfx->highres;
+    gfx_auto_tick();
+    if (gfx->widescreen != gfx->target_widescreen)
+    {
+        gfx->widescreen = gfx->target_widescreen;
+        gfx_update_scale();
+    }
+    const bool interlaced = (gfx->res_mode != GFX_RES_LOW);
+    if (gfx->tier == gfx->target_tier && gfx->buffers == gfx->target_buffers &&
+        gfx_vi.interlaced == interlaced) return;
+
+    /*
+     * Within the shared display, queued frames keep their buffers and VI
+     * settings, so nothing waits for them. Leaving or entering manual low
+     * resolution replaces the display, whose buffers the RDP may still be
+     * drawing to.
+     */
+    const ticks_t start_ticks = timer_ticks();
+    const bool reinit = (gfx_vi.interlaced != interlaced);
+    if (reinit)
+    {
+        rdpmon_block_begin();
+        rspq_wait();
+        rdpmon_block_end();
+        display_close();
+        gfx_display_init(interlaced);
+    }
+    gfx->buffers = gfx->target_buffers;
+    gfx_set_tier(gfx->target_tier);
+    gfx_auto.frame = -GFX_AUTO_SETTLE_FRAMES;
+    const ticks_t end_ticks = timer_ticks();
+    blackbox_event(BLACKBOX_EVENT_DISPLAY);
+
+    debugf("[GFX] Switched to %dx%d (tier %d, %d buffers%s) in %lu us\n",
+        gfx->width, gfx->height, gfx->tier, gfx->buffers,
+        reinit ? ", display reinitialized" : "",
+        (unsigned long)TICKS_TO_US(end_ticks - start_ticks));
+    gfx->switch_ticks = end_ticks;
+}
+
+/*
+ * With fewer buffers than allocated, a frame may only start once no more
+ * than that many would be queued. Polled by the pacing wait, which tops up
+ * audio meanwhile; the time refused counts as blocked on the display.
+ */
+bool gfx_display_ready(void)
+{
+    const bool ready = (gfx_vi.frames - 1 - gfx_vi.shown_frame <= gfx->buffers - 2);
+    if (!ready && !gfx_vi.throttled)
+    {
+        rdpmon_block_begin();
+        gfx_vi.throttled = true;
+    }
+    else if (ready && gfx_vi.throttled)
+    {
+        rdpmon_block_end();
+        gfx_vi.throttled = false;
+    }
+    return ready;
 }
 
 void gfx_display_lock(void)
 {
-    /* Grab a render buffer */
+    /* Grab a render buffer; waits for the RDP to finish with one if none are free */
+    rdpmon_block_begin();
     surface_t *disp = display_get();
-    rdpq_attach_clear(disp, NULL);
+    rdpmon_block_end();
     gfx->disp = disp;
+
+    /*
+     * Each queued frame is shown for one field, so this one lands on the
+     * field after the last of them, unless drawing it takes longer than
+     * that. A buffer kept up for several fields is scanned by both, so it
+     * draws the even lines and both fields show them.
+     */
+    const bool one_field = (gfx->tier == GFX_TIER_LOW) ||
+        (gfx->tier == GFX_TIER_FIELD && pace_get_interval_vblanks() != 1);
+    gfx->field = 0;
+    if (gfx->tier == GFX_TIER_FIELD && !one_field)
+    {
+        const int pending = gfx_vi.frames - 1 - gfx_vi.shown_frame;
+        gfx->field = (*GFX_VI_V_CURRENT ^ (pending + 1) ^ gfx_vi.line_xor) & 1;
+    }
+
+    /* Rows of a 240-line target are every other line of the buffer */
+    const int line_step = disp->height / gfx->height;
+    gfx->target = surface_make((uint8_t *)disp->buffer + gfx->field * disp->stride,
+        surface_get_format(disp), gfx->width, gfx->height, disp->stride * line_step);
+    gfx_scanout_set(disp, &(gfx_scanout_t){
+        .frame = gfx_vi.frames++,
+        .filters = (gfx->tier == GFX_TIER_HIGH),
+        .half_width = (gfx->tier == GFX_TIER_LOW),
+        .one_field = one_field,
+    });
+    rdpq_attach_clear(&gfx->target, NULL);
+
+    /* The visible hitch is the gap between the frames either side of a switch */
+    const ticks_t now_ticks = timer_ticks();
+    if (gfx->switch_ticks)
+    {
+        debugf("[GFX] Frame gap across switch: %lu us\n",
+            (unsigned long)TICKS_TO_US(now_ticks - gfx->frame_ticks));
+        gfx->switch_ticks = 0;
+    }
+    gfx->frame_ticks = now_ticks;
+}
+
+/* The frame number of the buffer locked last */
+int gfx_get_frame(void)
+{
+    return gfx_vi.frames - 1;
+}
+
+/*
+ * When the VI first scanned out a frame, as seen on the vblank it swapped
+ * in. False until then, and for good once its buffer has been reused.
+ */
+bool gfx_get_scanout_ticks(int frame, uint64_t *ticks)
+{
+    bool shown = false;
+    disable_interrupts();
+    for (int i = 0; i < GFX_BUFFERS_MAX; i++)
+    {
+        const gfx_scanout_t *const scanout = &gfx_vi.scanouts[i];
+        if (scanout->start == 0 || scanout->frame != frame || !scanout->shown_ticks) continue;
+        *ticks = scanout->shown_ticks;
+        shown = true;
+        break;
+    }
+    enable_interrupts();
+    return shown;
+}
+
+/* Queue the locked buffer for the VI once the RDP has finished with it */
+void gfx_display_show(void)
+{
+    rdpq_detach_cb((void (*)(void *))display_show, gfx->disp);
 }
 
 void gfx_attach_rdp(void)
@@ -80,6 +484,6 @@ void gfx_attach_rdp(void)
     if (!rdpq_is_attached() && gfx->disp)
     {
         /* Attach RDP to display - RDPQ handles sync automatically */
-        rdpq_attach(gfx->disp, NULL);
+        rdpq_attach(&gfx->target, NULL);
     }
 }
@@ -21,33 +21,130 @@
 #define GFX_BASE_WIDTH  320
 #define GFX_BASE_HEIGHT 240
 
+/*
+ * Anamorphic widescreen keeps the framebuffer size and squeezes everything
+ * horizontally so that a 16:9 set stretching the picture back out shows
+ * a wider view of the course: (4:3) / (16:9).
+ */
+#define GFX_WIDESCREEN_SQUEEZE 0.75f
+
+/* Fewer buffers cut latency; more let the CPU run ahead through slow frames */
+#define GFX_BUFFERS_MIN 2
+#define GFX_BUFFERS_MAX 3
+
+/*
+ * Rendering configurations, cheapest first. Manual low resolution has a
+ * 320x240 progressive display of its own. Every other mode shares one
+ * 640x480 interlaced display; each tier draws into part of its buffers and
+ * has the VI scan that part out, so they switch without reinitializing it.
+ */
+typedef enum
+{
+    GFX_TIER_LOW,       // 320x240 progressive, or shown on both fields under Auto
+    GFX_TIER_FIELD,     // 640x240 per field of a 480i picture
+    GFX_TIER_MEDIUM,    // 640x480 interlaced, no extra VI filtering
+    GFX_TIER_HIGH,      // 640x480 interlaced, VI anti-aliasing and de-dithering
+    // Additional tiers go above this line
+    GFX_TIERS_COUNT // Not a tier; just a count
+} gfx_tier_t;
+
+typedef enum
+{
+    GFX_RES_LOW,
+    GFX_RES_HIGH,
+    GFX_RES_FIELD,
+    GFX_RES_AUTO,       // Picks a tier from recent missed frames
+    // Additional modes go above this line
+    GFX_RES_MODES_COUNT // Not a mode; just a count
+} gfx_res_mode_t;
+
 typedef struct gfx_s
 {
     // Setup state
     int width;
     int height;
-    float scale;    // 1.0 for 320x240, 2.0 for 640x480
+    float scale_x;  // 1.0 for 320 wide, 2.0 for 640 wide; squeezed in widescreen
+    float scale_y;  // 1.0 for 240 lines (including fields), 2.0 for 480
     bool highres;   // true if in high-res mode
+    int field;      // Buffer line parity drawn while field rendering, otherwise 0
+    gfx_tier_t tier;
+    gfx_tier_t target_tier; // applied by gfx_tick between frames
+    gfx_res_mode_t res_mode;
+    bool widescreen;
+    bool target_widescreen; // applied by gfx_tick between frames
+    int buffers;            // How many frames may be queued, not allocated
+    int target_buffers;     // applied by gfx_tick between frames
     // Drawing state
-    surface_t *disp;
+    surface_t *disp;        // The whole display buffer
+    surface_t target;       // The lines of disp this frame draws
+    ticks_t frame_ticks;
+    ticks_t switch_ticks; // nonzero until the first frame after a switch
 } gfx_t;
 
 extern gfx_t *gfx;
 
-/* Scale a value by the current graphics scale factor */
-#define GFX_SCALE(v) ((int)((v) * gfx->scale))
-#define GFX_SCALEF(v) ((v) * gfx->scale)
+/* Scale a value by the current graphics scale factors */
+#define GFX_SCALE_X(v) ((int)((v) * gfx->scale_x))
+#define GFX_SCALE_Y(v) ((int)((v) * gfx->scale_y))
+
+/* World X positions are fractions of the 4:3 view; 0.0 is the left edge */
+#define GFX_WORLD_X(x) GFX_SCALE_X((x) * GFX_BASE_WIDTH)
+
+/* How much of the world is visible across the screen; 1.0 at 4:3 */
+static inline float gfx_view_width(void)
+{
+    return gfx->width / (gfx->scale_x * GFX_BASE_WIDTH);
+}
+
+/* Glyph size follows the line count, since that is what rows are laid out in */
+static inline int gfx_font_id(void)
+{
+    return (gfx->scale_y >= 2.0f) ? FONT_AT01_2X : FONT_AT01;
+}
+
+/*
+ * While field rendering, the odd field sits half a line lower on screen.
+ * Content positioned more finely than a line is drawn this much higher on
+ * odd fields so it lands where a full 480-line frame would put it; the art
+ * itself is 240 lines, so it covers both fields' lines without help.
+ */
+static inline float gfx_field_offset_y(void)
+{
+    return gfx->field ? -0.5f : 0.0f;
+}
 
 /* Graphics functions */
 
 void gfx_init(void);
 
+void gfx_tick(void);
+
+bool gfx_display_ready(void);
+
 void gfx_display_lock(void);
 
+void gfx_display_show(void);
+
+int gfx_get_frame(void);
+
+bool gfx_get_scanout_ticks(int frame, uint64_t *ticks);
+
 void gfx_attach_rdp(void);
 
 void gfx_set_highres(bool enable);
 
 bool gfx_get_highres(void);
 
+void gfx_set_res_mode(gfx_res_mode_t mode);
+
+gfx_res_mode_t gfx_get_res_mode(void);
+
+void gfx_set_widescreen(bool enable);
+
+bool gfx_get_widescreen(void);
+
+void gfx_set_buffers(int buffers);
+
+int gfx_get_buffers(void);
+
 #endif
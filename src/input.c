@@ -0,0 +1,88 @@
+/**
+ * FlappyBird-N64 - input.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "input.h"
+
+/* Input definitions */
+
+typedef struct input_s
+{
+    /* Filled by the VI interrupt, drained by input_tick */
+    input_edge_t queue[INPUT_QUEUE_SIZE];
+    volatile size_t head;
+    volatile size_t tail;
+    /* Edges drained this frame, oldest first */
+    input_edge_t edges[INPUT_QUEUE_SIZE];
+    size_t edge_count;
+} input_t;
+
+/* Input implementation */
+
+static input_t input = {0};
+
+static joypad_buttons_t input_get_buttons_pressed(joypad_port_t port)
+{
+    joypad_buttons_t buttons = joypad_get_buttons_pressed(port);
+    // Treat analog joystick axes as D-pad presses
+    const int stick_x = joypad_get_axis_pressed(port, JOYPAD_AXIS_STICK_X);
+    const int stick_y = joypad_get_axis_pressed(port, JOYPAD_AXIS_STICK_Y);
+    if (stick_x < 0) buttons.d_left = 1;
+    if (stick_x > 0) buttons.d_right = 1;
+    if (stick_y > 0) buttons.d_up = 1;
+    if (stick_y < 0) buttons.d_down = 1;
+    return buttons;
+}
+
+/*
+ * The joypad subsystem reads the controllers once per field in the
+ * background; latching that here rather than once per frame means a slow
+ * or half-rate frame still sees every press, with the time it was made.
+ */
+static void input_vi_handler(void)
+{
+    joypad_poll();
+    const joypad_buttons_t pressed = input_get_buttons_pressed(INPUT_PORT);
+    if (!pressed.raw) return;
+    const size_t head = input.head;
+    const size_t next = (head + 1) % INPUT_QUEUE_SIZE;
+    /* A full queue means nobody is draining it; the newest press is dropped */
+    if (next == input.tail) return;
+    input.queue[head].ticks = get_ticks();
+    input.queue[head].pressed = pressed;
+    input.head = next;
+}
+
+void input_init(void)
+{
+    memset(&input, 0, sizeof input);
+    register_VI_handler(input_vi_handler);
+}
+
+/* Drains the queue; returns every button pressed since the last frame */
+joypad_buttons_t input_tick(void)
+{
+    joypad_buttons_t buttons = {0};
+    input.edge_count = 0;
+    disable_interrupts();
+    while (input.tail != input.head)
+    {
+        const input_edge_t *const edge = &input.queue[input.tail];
+        input.edges[input.edge_count++] = *edge;
+        buttons.raw |= edge->pressed.raw;
+        input.tail = (input.tail + 1) % INPUT_QUEUE_SIZE;
+    }
+    enable_interrupts();
+    return buttons;
+}
+
+size_t input_get_edges(const input_edge_t **edges)
+{
+    *edges = input.edges;
+    return input.edge_count;
+}
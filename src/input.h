@@ -0,0 +1,35 @@
+/**
+ * FlappyBird-N64 - input.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_INPUT_H
+#define __FLAPPY_INPUT_H
+
+#include "system.h"
+
+/* Input definitions */
+
+#define INPUT_PORT          JOYPAD_PORT_1
+#define INPUT_QUEUE_SIZE    32  // About half a second of fields with a press in each
+
+/* Buttons that went down at one sample, stamped with get_ticks() */
+typedef struct input_edge_s
+{
+    uint64_t ticks;
+    joypad_buttons_t pressed;
+} input_edge_t;
+
+/* Input functions */
+
+void input_init(void);
+
+joypad_buttons_t input_tick(void);
+
+size_t input_get_edges(const input_edge_t **edges);
+
+#endif
@@ -0,0 +1,134 @@
+/**
+ * FlappyBird-N64 - latency.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "latency.h"
+
+#include "gfx.h"
+
+/* Latency definitions */
+
+/* Give up on a frame that never reaches the screen, e.g. across a switch */
+#define LATENCY_TIMEOUT_TICKS   (250 * TICKS_PER_MS)
+
+#define LATENCY_BUFFER_CHOICES  (GFX_BUFFERS_MAX - GFX_BUFFERS_MIN + 1)
+
+typedef struct latency_window_s
+{
+    int samples_us[LATENCY_WINDOW];
+    int next;
+    int count;
+} latency_window_t;
+
+typedef struct latency_s
+{
+    bool enabled;
+    uint64_t last_flap_ticks;
+    /* The frame waiting to be scanned out */
+    bool pending;
+    uint64_t flap_ticks;
+    int frame;
+    gfx_tier_t tier;
+    int buffers;
+    /* Rolling samples per tier and buffer count */
+    latency_window_t windows[GFX_TIERS_COUNT][LATENCY_BUFFER_CHOICES];
+} latency_t;
+
+/* Latency implementation */
+
+static latency_t latency = {0};
+
+void latency_init(void)
+{
+    memset(&latency, 0, sizeof latency);
+}
+
+static latency_window_t *latency_window(gfx_tier_t tier, int buffers)
+{
+    return &latency.windows[tier][buffers - GFX_BUFFERS_MIN];
+}
+
+static latency_stats_t latency_window_stats(const latency_window_t *window)
+{
+    latency_stats_t stats = {0};
+    if (window->count == 0) return stats;
+    int total = 0;
+    stats.count = window->count;
+    stats.min_us = stats.max_us = window->samples_us[0];
+    for (int i = 0; i < window->count; i++)
+    {
+        const int sample = window->samples_us[i];
+        if (sample < stats.min_us) stats.min_us = sample;
+        if (sample > stats.max_us) stats.max_us = sample;
+        total += sample;
+    }
+    stats.mean_us = total / window->count;
+    return stats;
+}
+
+static void latency_record(uint64_t scanout_ticks)
+{
+    const int sample_us = TICKS_TO_US(scanout_ticks - latency.flap_ticks);
+    latency_window_t *const window = latency_window(latency.tier, latency.buffers);
+    window->samples_us[window->next] = sample_us;
+    window->next = (window->next + 1) % LATENCY_WINDOW;
+    if (window->count < LATENCY_WINDOW) window->count++;
+
+    const latency_stats_t stats = latency_window_stats(window);
+    debugf("[LATENCY] tier %d x%d: %d us (min %d, mean %d, max %d over %d)\n",
+        latency.tier, latency.buffers, sample_us,
+        stats.min_us, stats.mean_us, stats.max_us, stats.count);
+}
+
+void latency_tick(const joypad_buttons_t *buttons)
+{
+    /* Toggle measuring on C-down */
+    if (buttons->c_down)
+    {
+        latency.enabled = !latency.enabled;
+    }
+
+    if (!latency.pending) return;
+    uint64_t scanout_ticks;
+    if (gfx_get_scanout_ticks(latency.frame, &scanout_ticks))
+    {
+        latency_record(scanout_ticks);
+    }
+    else if (get_ticks() - latency.flap_ticks < LATENCY_TIMEOUT_TICKS)
+    {
+        return;
+    }
+    latency.pending = false;
+}
+
+/*
+ * Called once the frame's buffer is locked. The first frame drawn after a
+ * flap is the first to show it, so its buffer is the one to watch for.
+ */
+void latency_frame(uint64_t flap_ticks)
+{
+    if (flap_ticks == latency.last_flap_ticks) return;
+    latency.last_flap_ticks = flap_ticks;
+    if (!latency.enabled || latency.pending) return;
+
+    latency.flap_ticks = flap_ticks;
+    latency.frame = gfx_get_frame();
+    latency.tier = gfx->tier;
+    latency.buffers = gfx->buffers;
+    latency.pending = true;
+}
+
+bool latency_get_enabled(void)
+{
+    return latency.enabled;
+}
+
+latency_stats_t latency_get_stats(void)
+{
+    return latency_window_stats(latency_window(gfx->tier, gfx->buffers));
+}
@@ -0,0 +1,40 @@
+/**
+ * FlappyBird-N64 - latency.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_LATENCY_H
+#define __FLAPPY_LATENCY_H
+
+#include "system.h"
+
+/* Latency definitions */
+
+#define LATENCY_WINDOW 16 // Samples kept per display configuration
+
+/* Rolling input-to-scanout figures for one display configuration */
+typedef struct latency_stats_s
+{
+    int count;
+    int min_us;
+    int mean_us;
+    int max_us;
+} latency_stats_t;
+
+/* Latency functions */
+
+void latency_init(void);
+
+void latency_tick(const joypad_buttons_t *buttons);
+
+void latency_frame(uint64_t flap_ticks);
+
+bool latency_get_enabled(void);
+
+latency_stats_t latency_get_stats(void);
+
+#endif
@@ -12,23 +12,54 @@
 #include "sfx.h"
 
 #include "bg.h"
+#include "blackbox.h"
 #include "bird.h"
 #include "collision.h"
 #include "fps.h"
+#include "input.h"
+#include "latency.h"
+#include "pace.h"
 #include "pipes.h"
+#include "prof.h"
+#include "rdpmon.h"
+#include "telem.h"
 #include "ui.h"
 
-static joypad_buttons_t game_get_buttons_pressed(joypad_port_t port)
+/*
+ * Draws the state the last tick left behind. Nothing touches it between the
+ * end of that tick and this call, so it is a consistent snapshot without
+ * a copy, and the draw only reads it through const pointers.
+ */
+static void game_draw(const bird_t *bird, const pipes_t *pipes, const ui_t *ui)
 {
-    joypad_buttons_t buttons = joypad_get_buttons_pressed(port);
-    // Treat analog joystick axes as D-pad presses
-    const int stick_x = joypad_get_axis_pressed(port, JOYPAD_AXIS_STICK_X);
-    const int stick_y = joypad_get_axis_pressed(port, JOYPAD_AXIS_STICK_Y);
-    if (stick_x < 0) buttons.d_left = 1;
-    if (stick_x > 0) buttons.d_right = 1;
-    if (stick_y > 0) buttons.d_up = 1;
-    if (stick_y < 0) buttons.d_down = 1;
-    return buttons;
+    /* Grab a display buffer and start drawing */
+    gfx_display_lock();
+    latency_frame(bird->flap_ticks);
+    {
+        /* Draw the game state */
+        prof_begin(PROF_DRAW_SKY);
+        bg_draw_sky();
+        prof_end(PROF_DRAW_SKY);
+        prof_begin(PROF_DRAW_PIPES);
+        pipes_draw(pipes);
+        prof_end(PROF_DRAW_PIPES);
+        prof_begin(PROF_DRAW_BIRD);
+        bird_draw(bird);
+        prof_end(PROF_DRAW_BIRD);
+        prof_begin(PROF_DRAW_GROUND);
+        bg_draw_ground();
+        prof_end(PROF_DRAW_GROUND);
+        prof_begin(PROF_DRAW_UI);
+        ui_draw(ui);
+        prof_end(PROF_DRAW_UI);
+        prof_begin(PROF_DRAW_FPS);
+        fps_draw();
+        prof_end(PROF_DRAW_FPS);
+    }
+    /* Finish drawing and show the framebuffer */
+    gfx_display_show();
+    /* Have the RSP start on the commands now rather than when they fill a block */
+    rspq_flush();
 }
 
 int main(void)
@@ -40,10 +71,12 @@ int main(void)
     /* Initialize libdragon subsystems */
     timer_init();
     joypad_init();
+    input_init();
     dfs_init(DFS_DEFAULT_LOCATION);
 
     /* Initialize game subsystems */
     gfx_init();
+    rdpmon_init();
     sfx_init();
 
     // rdpq_debug_start();
@@ -51,18 +84,46 @@ int main(void)
 
     /* Initialize game state */
     bg_init();
+    pace_init();
+    latency_init();
     fps_init();
     bird_t *const bird = bird_init(BIRD_COLOR_YELLOW);
     pipes_t *const pipes = pipes_init();
     ui_t *const ui = ui_init();
     joypad_buttons_t buttons;
 
+#ifdef FLAPPY_BENCHMARK
+    bird_benchmark(bird);
+#endif
+
     /* Run the main loop */
     while (1)
     {
-        /* Update joypad state */
-        joypad_poll();
-        buttons = game_get_buttons_pressed(JOYPAD_PORT_1);
+        /* Start each frame on its vblank with a buffer free, topping up audio */
+        while (!pace_frame_due())
+        {
+            sfx_tick();
+        }
+        pace_frame_begin();
+        prof_frame();
+        rdpmon_frame();
+        telem_frame(bird);
+        blackbox_frame(bird);
+
+        /*
+         * Submit the previous tick's frame first, so the RDP renders it
+         * while the CPU simulates the next one instead of each waiting on
+         * the other. What is shown trails the simulation by one tick.
+         */
+        game_draw(bird, pipes, ui);
+
+        /* Apply any resolution switch, so the next tick lays out for it */
+        gfx_tick();
+
+        /* Collect the presses sampled since the last frame */
+        prof_begin(PROF_INPUT);
+        buttons = input_tick();
+        prof_end(PROF_INPUT);
 
         /* Toggle high-res mode with Z button */
         if (buttons.z)
@@ -72,58 +133,63 @@ int main(void)
 
         /* Update bird state before the rest of the world */
         const bird_state_t prev_bird_state = bird->state;
+        prof_begin(PROF_BIRD);
         bird_tick(bird, &buttons);
+        prof_end(PROF_BIRD);
 
         /* Reset the world when the bird resets after dying */
         if (prev_bird_state != bird->state && prev_bird_state == BIRD_STATE_DEAD)
         {
             bg_randomize_time_mode();
             pipes_reset(pipes);
+            blackbox_event(BLACKBOX_EVENT_RESET);
         }
 
         /* Update the world state based on the bird state */
         switch (bird->state)
         {
         case BIRD_STATE_TITLE:
+            prof_begin(PROF_UI);
             ui_menu_tick(ui, bird, &buttons);
+            prof_end(PROF_UI);
+            prof_begin(PROF_BG);
             bg_tick(&buttons);
+            prof_end(PROF_BG);
             break;
         case BIRD_STATE_READY:
+            prof_begin(PROF_BG);
             bg_tick(&buttons);
+            prof_end(PROF_BG);
             break;
         case BIRD_STATE_PLAY:
+            prof_begin(PROF_BG);
             bg_tick(&buttons);
+            prof_end(PROF_BG);
+            prof_begin(PROF_PIPES);
             pipes_tick(pipes);
+            prof_end(PROF_PIPES);
+            prof_begin(PROF_COLLISION);
             collision_tick(bird, pipes);
+            prof_end(PROF_COLLISION);
             break;
         default:
             break;
         }
 
         /* Update the UI based on the world state */
+        prof_begin(PROF_UI);
         ui_tick(ui, bird);
+        prof_end(PROF_UI);
+        latency_tick(&buttons);
+        telem_tick(&buttons);
         fps_tick(&buttons);
 
         /* Buffer sound effects */
-        if (audio_can_write())
-        {
-            short *const buf = audio_write_begin();
-            mixer_poll(buf, audio_get_buffer_length());
-            audio_write_end();
-        }
+        prof_begin(PROF_AUDIO);
+        sfx_tick();
+        prof_end(PROF_AUDIO);
 
-        /* Grab a display buffer and start drawing */
-        gfx_display_lock();
-        {
-            /* Draw the game state */
-            bg_draw_sky();
-            pipes_draw(pipes);
-            bird_draw(bird);
-            bg_draw_ground();
-            ui_draw(ui);
-            fps_draw();
-        }
-        /* Finish drawing and show the framebuffer */
-        rdpq_detach_show();
+        /* Send this frame's telemetry records, if any */
+        telem_flush();
     }
 }
@@ -0,0 +1,133 @@
+/**
+ * FlappyBird-N64 - pace.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include <math.h>
+
+#include "pace.h"
+
+#include "gfx.h"
+
+/* Pacing definitions */
+
+#define PACE_ERROR_SMOOTHING 16 // Frames the pacing error is averaged over
+
+typedef struct pace_s
+{
+    pace_rate_t rate;
+    float vi_hz;
+    /* Written by the VI interrupt */
+    volatile uint32_t vblanks;
+    volatile ticks_t vblank_ticks;
+    /* Frame start bookkeeping */
+    uint32_t frame_vblank;
+    uint32_t frame_vblanks; // Between the last two frame starts
+    ticks_t frame_ticks;
+    int frames;
+    int late_frames;
+    ticks_t error_ticks; // Smoothed |actual - target| frame interval
+} pace_t;
+
+/* Pacing implementation */
+
+static pace_t pace = {0};
+
+static void pace_vi_handler(void)
+{
+    pace.vblank_ticks = timer_ticks();
+    pace.vblanks++;
+}
+
+void pace_init(void)
+{
+    memset(&pace, 0, sizeof pace);
+    pace.rate = PACE_RATE_FULL;
+    /* Fields arrive at the TV standard's rate, whatever the resolution */
+    pace.vi_hz = display_get_refresh_rate();
+    register_VI_handler(pace_vi_handler);
+}
+
+static uint32_t pace_interval(void)
+{
+    return (pace.rate == PACE_RATE_HALF) ? 2 : 1;
+}
+
+/*
+ * A frame may start once the vblank it is due at has passed and the
+ * display will take another frame. Both only change from the VI
+ * interrupt, so a caller polling this between other work stays on the
+ * cached copies instead of hammering the bus.
+ */
+bool pace_frame_due(void)
+{
+    if ((int32_t)(pace.vblanks - (pace.frame_vblank + pace_interval())) < 0) return false;
+    return gfx_display_ready();
+}
+
+void pace_frame_begin(void)
+{
+    const uint32_t vblank = pace.vblanks;
+    const ticks_t now_ticks = timer_ticks();
+    if (pace.frames > 0)
+    {
+        /* Started past its slot: the previous frame was shown for longer */
+        if ((int32_t)(vblank - (pace.frame_vblank + pace_interval())) > 0)
+        {
+            pace.late_frames++;
+        }
+        ticks_t error = (now_ticks - pace.frame_ticks) - pace_get_frame_ticks();
+        if (error < 0) error = -error;
+        pace.error_ticks += (error - pace.error_ticks) / PACE_ERROR_SMOOTHING;
+    }
+    /* Late frames re-anchor here rather than rushing to catch up */
+    pace.frame_vblanks = vblank - pace.frame_vblank;
+    pace.frame_vblank = vblank;
+    pace.frame_ticks = now_ticks;
+    pace.frames++;
+}
+
+void pace_set_rate(pace_rate_t rate)
+{
+    pace.rate = rate;
+}
+
+pace_rate_t pace_get_rate(void)
+{
+    return pace.rate;
+}
+
+int pace_get_hz(void)
+{
+    return lroundf(pace.vi_hz / pace_interval());
+}
+
+int pace_get_interval_vblanks(void)
+{
+    return pace_interval();
+}
+
+/* How long the previous frame stayed on screen, in vblanks */
+int pace_get_frame_vblanks(void)
+{
+    return pace.frame_vblanks;
+}
+
+ticks_t pace_get_frame_ticks(void)
+{
+    return TICKS_PER_SECOND * pace_interval() / pace.vi_hz;
+}
+
+int pace_get_late_frames(void)
+{
+    return pace.late_frames;
+}
+
+int pace_get_error_us(void)
+{
+    return TICKS_TO_US(pace.error_ticks);
+}
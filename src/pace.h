@@ -0,0 +1,67 @@
+/**
+ * FlappyBird-N64 - pace.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_PACE_H
+#define __FLAPPY_PACE_H
+
+#include "system.h"
+
+/* Pacing definitions */
+
+/* Frame rates are whole divisions of the VI refresh, so every frame is shown equally long */
+typedef enum
+{
+    PACE_RATE_FULL,     // Every vblank: 60 Hz NTSC/MPAL, 50 Hz PAL
+    PACE_RATE_HALF,     // Every other vblank: 30 Hz NTSC/MPAL, 25 Hz PAL
+    // Additional rates go above this line
+    PACE_RATES_COUNT // Not a rate; just a count
+} pace_rate_t;
+
+#define PACE_MAX_STEPS 4
+
+/*
+ * Counts the fixed-rate simulation steps due since *last_ticks. Like the
+ * single-step checks it replaces, the remainder is dropped, so one step runs
+ * per full-rate frame; slower frames run every step they covered. A longer
+ * gap is a resume or a hitch rather than frames to make up, so it runs one.
+ */
+static inline int pace_steps(uint64_t *last_ticks, uint64_t now_ticks, uint64_t step_ticks)
+{
+    const uint64_t elapsed = now_ticks - *last_ticks;
+    if (elapsed < step_ticks) return 0;
+    *last_ticks = now_ticks;
+    const uint64_t steps = elapsed / step_ticks;
+    return (steps > PACE_MAX_STEPS) ? 1 : (int)steps;
+}
+
+/* Pacing functions */
+
+void pace_init(void);
+
+bool pace_frame_due(void);
+
+void pace_frame_begin(void);
+
+void pace_set_rate(pace_rate_t rate);
+
+pace_rate_t pace_get_rate(void);
+
+int pace_get_hz(void);
+
+int pace_get_interval_vblanks(void);
+
+int pace_get_frame_vblanks(void);
+
+ticks_t pace_get_frame_ticks(void);
+
+int pace_get_late_frames(void);
+
+int pace_get_error_us(void);
+
+#endif
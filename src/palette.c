@@ -0,0 +1,117 @@
+/**
+ * FlappyBird-N64 - palette.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "palette.h"
+
+/* Palette definitions */
+
+#define PALETTE_MAGIC "TLUT"
+
+/* Layout written by `gfxtool variants`; rows start 8-byte aligned */
+typedef struct palette_header_s
+{
+    char magic[4];
+    uint16_t variants;
+    uint16_t colors;
+    uint16_t base;
+    uint16_t stride;
+    uint32_t reserved;
+} palette_header_t;
+
+/* Palette implementation */
+
+palette_t *palette_load(const char *name)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "rom:/gfx/%s.tlut", name);
+    int size;
+    void *const data = asset_load(path, &size);
+    const palette_header_t *const header = data;
+    assertf(memcmp(header->magic, PALETTE_MAGIC, 4) == 0, "Invalid TLUT file: %s", path);
+    /* The RDP reads palettes straight from RDRAM */
+    data_cache_hit_writeback(data, size);
+    palette_t *const palette = malloc(sizeof(palette_t));
+    palette->data = data;
+    palette->entries = (uint16_t *)(header + 1);
+    palette->variants = header->variants;
+    palette->colors = header->colors;
+    palette->base = header->base;
+    palette->stride = header->stride;
+    return palette;
+}
+
+void palette_free(palette_t *palette)
+{
+    free(palette->data);
+    palette->data = NULL;
+    palette->entries = NULL;
+    free(palette);
+}
+
+static uint16_t palette_lerp_5551(uint16_t a, uint16_t b, int k, int steps)
+{
+    uint16_t c = 0;
+    for (int shift = 1; shift < 16; shift += 5)
+    {
+        const int ca = (a >> shift) & 0x1F;
+        const int cb = (b >> shift) & 0x1F;
+        c |= (ca + ((cb - ca) * k + steps / 2) / steps) << shift;
+    }
+    /* Coverage can't be blended; it flips halfway through */
+    return c | ((k * 2 < steps ? a : b) & 1);
+}
+
+/*
+ * Expands a palette into `steps` rows between each pair of consecutive
+ * variants, so fades pick a precomputed row instead of rewriting a TLUT the
+ * RDP may still be reading. Variant v of the source is row v * steps.
+ */
+palette_t *palette_make_ramp(const palette_t *palette, int steps)
+{
+    assert(steps > 0);
+    const int variants = (palette->variants - 1) * steps + 1;
+    const int stride = palette->stride;
+    const size_t size = variants * stride * sizeof(uint16_t);
+    uint16_t *const entries = malloc(size);
+    for (int row = 0; row < variants; row++)
+    {
+        const int from = row / steps;
+        const int k = row % steps;
+        const int to = (k == 0) ? from : from + 1;
+        for (int i = 0; i < stride; i++)
+        {
+            entries[row * stride + i] = palette_lerp_5551(
+                palette->entries[from * stride + i], palette->entries[to * stride + i], k, steps);
+        }
+    }
+    data_cache_hit_writeback(entries, size);
+    palette_t *const ramp = malloc(sizeof(palette_t));
+    *ramp = *palette;
+    ramp->data = entries;
+    ramp->entries = entries;
+    ramp->variants = variants;
+    return ramp;
+}
+
+/* Index sprites are converted as I4/I8; their texels are TLUT indices */
+surface_t palette_index_surface(sprite_t *sprite)
+{
+    surface_t pixels = sprite_get_pixels(sprite);
+    const tex_format_t format = surface_get_format(&pixels) == FMT_I4 ? FMT_CI4 : FMT_CI8;
+    return surface_make(pixels.buffer, format, pixels.width, pixels.height, pixels.stride);
+}
+
+/* Enables TLUT mode and loads one color variant at the palette's base entry */
+void palette_upload(const palette_t *palette, int variant)
+{
+    assert(variant >= 0 && variant < palette->variants);
+    rdpq_mode_tlut(TLUT_RGBA16);
+    rdpq_tex_upload_tlut(&palette->entries[variant * palette->stride],
+        palette->base, palette->colors);
+}
@@ -0,0 +1,46 @@
+/**
+ * FlappyBird-N64 - palette.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_PALETTE_H
+#define __FLAPPY_PALETTE_H
+
+#include "system.h"
+
+/* Palette definitions */
+
+/* Color variants of one index sprite; generated by gfxtool from manifest.txt */
+typedef struct palette_s
+{
+    void *data;
+    uint16_t *entries;
+    int variants;
+    int colors;
+    int base;
+    int stride;
+} palette_t;
+
+/* CI4 textures select their 16-entry TLUT bank through the tile palette */
+static inline int palette_bank(const palette_t *palette)
+{
+    return palette->base / 16;
+}
+
+/* Palette functions */
+
+palette_t *palette_load(const char *name);
+
+void palette_free(palette_t *palette);
+
+palette_t *palette_make_ramp(const palette_t *palette, int steps);
+
+surface_t palette_index_surface(sprite_t *sprite);
+
+void palette_upload(const palette_t *palette, int variant);
+
+#endif
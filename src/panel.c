@@ -0,0 +1,67 @@
+/**
+ * FlappyBird-N64 - panel.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "panel.h"
+
+#include "gfx.h"
+
+/* Panel implementation */
+
+/*
+ * Frames already queued may still blit from the old buffer, so it is only
+ * released once the RDP has caught up, without waiting for it here.
+ */
+void panel_free(panel_t *panel)
+{
+    if (!panel_is_valid(panel)) return;
+    rdpq_call_deferred(free_uncached, panel->surface.buffer);
+    panel->surface = surface_make_zero();
+}
+
+/*
+ * Allocates a surface covering rect (clipped to the screen) and redirects
+ * rdpq into it, cleared to transparent. Callers draw in screen space offset
+ * by -panel->x, -panel->y and must call panel_end when done.
+ */
+bool panel_begin(panel_t *panel, const panel_rect_t *rect)
+{
+    panel_free(panel);
+    const int x0 = rect->x0 > 0 ? rect->x0 : 0;
+    const int y0 = rect->y0 > 0 ? rect->y0 : 0;
+    const int x1 = rect->x1 < gfx->width ? rect->x1 : gfx->width;
+    const int y1 = rect->y1 < gfx->height ? rect->y1 : gfx->height;
+    if (x1 <= x0 || y1 <= y0) return false;
+    /* RGBA16 keeps the coverage bit, so empty pixels stay transparent */
+    const int width = x1 - x0;
+    const int height = y1 - y0;
+    const int stride = TEX_FORMAT_PIX2BYTES(FMT_RGBA16, width);
+    void *const buffer = malloc_uncached_aligned(64, height * stride);
+    if (buffer == NULL) return false;
+    panel->surface = surface_make(buffer, FMT_RGBA16, width, height, stride);
+    panel->x = x0;
+    panel->y = y0;
+    rdpq_attach(&panel->surface, NULL);
+    rdpq_clear(RGBA32(0x00, 0x00, 0x00, 0x00));
+    return true;
+}
+
+/* Only a panel that panel_begin returned true for is attached */
+void panel_end(panel_t *panel)
+{
+    assertf(panel_is_valid(panel), "panel_end without a successful panel_begin");
+    rdpq_detach();
+}
+
+void panel_draw(const panel_t *panel)
+{
+    if (!panel_is_valid(panel)) return;
+    /* 1:1 copy with alpha compare; rdpq_tex_blit splits it across TMEM loads */
+    rdpq_set_mode_copy(true);
+    rdpq_tex_blit(&panel->surface, panel->x, panel->y, NULL);
+}
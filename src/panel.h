@@ -0,0 +1,61 @@
+/**
+ * FlappyBird-N64 - panel.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_PANEL_H
+#define __FLAPPY_PANEL_H
+
+#include "system.h"
+
+#include <limits.h>
+
+/* Panel definitions */
+
+/* Screen-space bounds; x1 and y1 are exclusive */
+typedef struct panel_rect_s
+{
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+} panel_rect_t;
+
+#define PANEL_RECT_EMPTY ((panel_rect_t){ INT_MAX, INT_MAX, INT_MIN, INT_MIN })
+
+static inline void panel_rect_add(panel_rect_t *rect, int x, int y, int width, int height)
+{
+    if (x < rect->x0) rect->x0 = x;
+    if (y < rect->y0) rect->y0 = y;
+    if (x + width > rect->x1) rect->x1 = x + width;
+    if (y + height > rect->y1) rect->y1 = y + height;
+}
+
+/* A group of static draws composited offscreen and drawn as one blit */
+typedef struct panel_s
+{
+    surface_t surface;
+    int x;
+    int y;
+} panel_t;
+
+static inline bool panel_is_valid(const panel_t *panel)
+{
+    return panel->surface.buffer != NULL;
+}
+
+/* Panel functions */
+
+void panel_free(panel_t *panel);
+
+bool panel_begin(panel_t *panel, const panel_rect_t *rect);
+
+void panel_end(panel_t *panel);
+
+void panel_draw(const panel_t *panel);
+
+#endif
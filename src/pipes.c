@@ -15,6 +15,7 @@
 #include "system.h"
 #include "gfx.h"
 #include "bg.h"
+#include "pace.h"
 
 /* Pipes definitions */
 
@@ -24,7 +25,7 @@
 #define PIPE_CAP_HEIGHT     ((int)13)
 #define PIPE_GAP_Y          ((int)80)
 #define PIPE_GAP_X          ((float)0.3)
-#define PIPE_START_X        ((float)1.1)
+#define PIPE_START_DX       ((float)0.1) /* Past the right edge of the view */
 #define PIPE_MIN_X          ((float)-0.1)
 #define PIPE_MAX_Y          ((float)0.5)
 #define PIPE_MAX_BIAS_Y     ((float)0.4)
@@ -38,6 +39,13 @@ pipes_t *pipes_init(void)
     pipes->scroll_ticks = 0;
     pipes->cap_sprite = sprite_load("rom:/gfx/pipe-cap.sprite");
     pipes->tube_sprite = sprite_load("rom:/gfx/pipe-tube.sprite");
+    /* Pipe colors are TLUT rows; both palettes must be resident at once */
+    pipes->cap_palette = palette_load("pipe-cap");
+    pipes->tube_palette = palette_load("pipe-tube");
+    assert(pipes->cap_palette->variants >= PIPE_COLORS_COUNT);
+    assert(pipes->tube_palette->variants >= PIPE_COLORS_COUNT);
+    assert(pipes->tube_palette->base + pipes->tube_palette->colors <= pipes->cap_palette->base ||
+           pipes->cap_palette->base + pipes->cap_palette->colors <= pipes->tube_palette->base);
     pipes_reset(pipes);
     return pipes;
 }
@@ -48,6 +56,10 @@ void pipes_free(pipes_t *pipes)
     pipes->cap_sprite = NULL;
     sprite_free(pipes->tube_sprite);
     pipes->tube_sprite = NULL;
+    palette_free(pipes->cap_palette);
+    pipes->cap_palette = NULL;
+    palette_free(pipes->tube_palette);
+    pipes->tube_palette = NULL;
     free(pipes);
 }
 
@@ -56,9 +68,22 @@ static pipe_color_t pipes_random_color(void)
     return ((float)rand() / (float)RAND_MAX) * PIPE_COLORS_COUNT;
 }
 
-static size_t pipe_prev_index(size_t current_index)
+static size_t pipe_prev_index(const pipes_t *pipes, size_t current_index)
 {
-    return (current_index > 0) ? current_index - 1 : PIPES_MAX_COUNT - 1;
+    return (current_index > 0) ? current_index - 1 : pipes->count - 1;
+}
+
+/*
+ * A pipe is recycled once it passes PIPE_MIN_X and respawns a gap behind
+ * the last one, so the ring needs enough pipes to span from there to just
+ * past the right edge of whatever is visible, plus the one being recycled.
+ */
+static void pipes_layout(pipes_t *pipes)
+{
+    pipes->view_w = gfx_view_width();
+    pipes->count = ceilf((pipes->view_w - PIPE_MIN_X) / PIPE_GAP_X) + 1;
+    assertf(pipes->count <= PIPES_MAX_COUNT, "Too many pipes for the view: %u",
+        (unsigned)pipes->count);
 }
 
 static float pipe_random_y(void)
@@ -85,10 +110,11 @@ void pipes_reset(pipes_t *pipes)
 {
     pipe_t *pipe;
     float y = pipe_random_y();
-    for (size_t i = 0; i < PIPES_MAX_COUNT; i++)
+    pipes_layout(pipes);
+    for (size_t i = 0; i < pipes->count; i++)
     {
         pipe = &pipes->n[i];
-        pipe->x = PIPE_START_X + (i * PIPE_GAP_X);
+        pipe->x = pipes->view_w + PIPE_START_DX + (i * PIPE_GAP_X);
         pipe->y = y;
         pipe->has_scored = false;
         /* Pipes are positioned relative to the previous pipe */
@@ -104,26 +130,31 @@ void pipes_tick(pipes_t *pipes)
     /* Start scrolling after a reset */
     if (pipes->scroll_ticks == 0)
     {
+        /* The aspect ratio may have changed on the title screen */
+        if (pipes->view_w != gfx_view_width())
+        {
+            pipes_reset(pipes);
+        }
         pipes->scroll_ticks = now_ticks;
     }
     /* Scroll the pipes and reset them as they go off-screen */
-    if ((now_ticks - pipes->scroll_ticks) >= PIPES_SCROLL_RATE)
+    int steps = pace_steps(&pipes->scroll_ticks, now_ticks, PIPES_SCROLL_RATE);
+    for (; steps > 0; steps--)
     {
         pipe_t *pipe;
-        for (size_t i = 0, j; i < PIPES_MAX_COUNT; i++)
+        for (size_t i = 0, j; i < pipes->count; i++)
         {
             pipe = &pipes->n[i];
             pipe->x += PIPES_SCROLL_DX;
             /* Has the pipe gone off the left of the screen? */
             if (pipe->x < PIPE_MIN_X)
             {
-                j = pipe_prev_index(i);
+                j = pipe_prev_index(pipes, i);
                 pipe->x = pipes->n[j].x + PIPE_GAP_X;
                 pipe->y = pipe_random_bias_y(pipes->n[j].y);
                 pipe->has_scored = false;
             }
         }
-        pipes->scroll_ticks = now_ticks;
     }
 }
 
@@ -140,32 +171,57 @@ void pipes_draw(const pipes_t *pipes)
     const int cap_slice_h = cap->height / cap->vslices;
 
     /* Scaled dimensions */
-    const int scaled_tube_w = GFX_SCALE(PIPE_TUBE_WIDTH);
-    const int scaled_gap_y = GFX_SCALE(PIPE_GAP_Y);
-    const int scaled_cap_h = GFX_SCALE(PIPE_CAP_HEIGHT);
+    const int scaled_tube_w = GFX_SCALE_X(PIPE_TUBE_WIDTH);
+    const int scaled_gap_y = GFX_SCALE_Y(PIPE_GAP_Y);
+    const int scaled_cap_w = GFX_SCALE_X(cap_slice_w);
+    const int scaled_cap_h = GFX_SCALE_Y(PIPE_CAP_HEIGHT);
 
-    /* Texture offset for the pipe color */
-    const int tube_s_offset = color * tube_slice_w;
-    const int cap_s_offset = color * cap_slice_w;
-    /* Top cap uses the second row (flipped cap) */
-    const int top_cap_t_offset = cap_slice_h;
+    /* Every color shares the same texels; only the palette differs */
+    const int tube_s0 = 0;
+    const int tube_s1 = tube_slice_w;
+    const int cap_s0 = 0;
+    const int cap_s1 = cap_slice_w;
+    /* Bottom cap uses the first row; top cap uses the second (flipped) row */
+    const int bottom_cap_t0 = 0;
+    const int top_cap_t0 = cap_slice_h;
 
     rdpq_set_mode_standard();
     rdpq_mode_alphacompare(1);
 
-    /* First pass: draw all tubes with hardware tiling */
+    /* Load this color's rows; the tube and cap occupy separate TLUT entries */
+    palette_upload(pipes->tube_palette, color);
+    palette_upload(pipes->cap_palette, color);
+
+    /*
+     * Upload the tube and both cap rows for this color side-by-side in TMEM
+     * so that every tube and cap can be drawn without reloading textures:
+     *   TILE0: tube slice (tiled vertically)
+     *   TILE1: bottom cap slice
+     *   TILE2: top cap slice
+     * Sub-uploads keep the original sprite texture coordinates.
+     */
+    surface_t tube_surf = palette_index_surface(tube);
+    surface_t cap_surf = palette_index_surface(cap);
     rdpq_texparms_t tube_texparams = {
+        .palette = palette_bank(pipes->tube_palette),
         .s = { .repeats = 1, .mirror = MIRROR_NONE },
         .t = { .repeats = REPEAT_INFINITE, .mirror = MIRROR_NONE },
     };
-    rdpq_sprite_upload(TILE0, tube, &tube_texparams);
+    rdpq_tex_multi_begin();
+    rdpq_tex_upload_sub(TILE0, &tube_surf, &tube_texparams,
+        tube_s0, 0, tube_s1, tube->height);
+    rdpq_tex_upload_sub(TILE1, &cap_surf, NULL,
+        cap_s0, bottom_cap_t0, cap_s1, bottom_cap_t0 + cap_slice_h);
+    rdpq_tex_upload_sub(TILE2, &cap_surf, NULL,
+        cap_s0, top_cap_t0, cap_s1, top_cap_t0 + cap_slice_h);
+    rdpq_tex_multi_end();
 
     const pipe_t *pipe;
-    for (size_t i = 0; i < PIPES_MAX_COUNT; i++)
+    for (size_t i = 0; i < pipes->count; i++)
     {
         pipe = &pipes->n[i];
         /* Calculate X position */
-        cx = gfx->width * pipe->x;
+        cx = GFX_WORLD_X(pipe->x);
         tx = cx - (scaled_tube_w / 2);
         bx = cx + (scaled_tube_w / 2);
         /* Don't bother drawing the pipe if it is off-screen */
@@ -178,56 +234,27 @@ void pipes_draw(const pipes_t *pipes)
         ty = 0;
         by = gap_cy - (scaled_gap_y / 2);
         {
-            float tex_height = (by - ty) / gfx->scale;
+            float tex_height = (by - ty) / gfx->scale_y;
             rdpq_texture_rectangle_scaled(TILE0, tx, ty, bx, by,
-                tube_s_offset, 0,
-                tube_s_offset + tube_slice_w, tex_height);
+                tube_s0, 0, tube_s1, tex_height);
         }
 
+        /* Top cap */
+        rdpq_texture_rectangle_scaled(TILE2, tx, by, tx + scaled_cap_w, by + scaled_cap_h,
+            cap_s0, top_cap_t0, cap_s1, top_cap_t0 + cap_slice_h);
+
         /* Bottom tube - hardware vertical tiling */
         ty = gap_cy + (scaled_gap_y / 2);
         by = BG_GROUND_TOP_Y;
         {
-            float tex_height = (by - ty) / gfx->scale;
+            float tex_height = (by - ty) / gfx->scale_y;
             rdpq_texture_rectangle_scaled(TILE0, tx, ty, bx, by,
-                tube_s_offset, 0,
-                tube_s_offset + tube_slice_w, tex_height);
+                tube_s0, 0, tube_s1, tex_height);
         }
-    }
-
-    /* Second pass: draw all caps (separate pass since sprite_blit clobbers TMEM) */
-    for (size_t i = 0; i < PIPES_MAX_COUNT; i++)
-    {
-        pipe = &pipes->n[i];
-        /* Calculate X position */
-        cx = gfx->width * pipe->x;
-        tx = cx - (scaled_tube_w / 2);
-        bx = cx + (scaled_tube_w / 2);
-        /* Don't bother drawing the pipe if it is off-screen */
-        if (bx < 0 || tx >= gfx->width) continue;
-        /* Calculate Y position */
-        cy = (BG_GROUND_TOP_Y / 2);
-        gap_cy = cy + pipe->y * cy;
-
-        /* Top cap (uses flipped sprite in second row) */
-        ty = gap_cy - (scaled_gap_y / 2);
-        rdpq_sprite_blit(cap, tx, ty, &(rdpq_blitparms_t){
-            .s0 = cap_s_offset,
-            .t0 = top_cap_t_offset,
-            .width = cap_slice_w,
-            .height = cap_slice_h,
-            .scale_x = gfx->scale,
-            .scale_y = gfx->scale,
-        });
 
         /* Bottom cap */
-        ty = gap_cy + (scaled_gap_y / 2) - scaled_cap_h;
-        rdpq_sprite_blit(cap, tx, ty, &(rdpq_blitparms_t){
-            .s0 = cap_s_offset,
-            .width = cap_slice_w,
-            .height = cap_slice_h,
-            .scale_x = gfx->scale,
-            .scale_y = gfx->scale,
-        });
+        ty -= scaled_cap_h;
+        rdpq_texture_rectangle_scaled(TILE1, tx, ty, tx + scaled_cap_w, ty + scaled_cap_h,
+            cap_s0, bottom_cap_t0, cap_s1, bottom_cap_t0 + cap_slice_h);
     }
 }
@@ -11,14 +11,16 @@
 #define __FLAPPY_PIPES_H
 
 #include "system.h"
+#include "palette.h"
 
-#define PIPES_MAX_COUNT 5
+/* Enough for the widest view; pipes_reset sizes the ring to the view */
+#define PIPES_MAX_COUNT 8
 
 typedef enum
 {
     PIPE_COLOR_GREEN,
     PIPE_COLOR_RED,
-    // Additional colors go above this line
+    // Additional colors go above this line (as TLUT rows; see variants= in manifest.txt)
     PIPE_COLORS_COUNT // Not a color; just a count
 } pipe_color_t;
 
@@ -36,6 +38,10 @@ typedef struct pipes_s
     uint64_t scroll_ticks;
     sprite_t *cap_sprite;
     sprite_t *tube_sprite;
+    palette_t *cap_palette;
+    palette_t *tube_palette;
+    float view_w;   // gfx_view_width() the ring was sized for
+    size_t count;   // Pipes in use; the rest of the array is idle
     pipe_t n[PIPES_MAX_COUNT];
 } pipes_t;
 
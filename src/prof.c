@@ -0,0 +1,176 @@
+/**
+ * FlappyBird-N64 - prof.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "prof.h"
+
+#include "gfx.h"
+#include "pace.h"
+
+/* Profiler definitions */
+
+#define PROF_BAR_WIDTH      2   // Per frame, before scaling
+#define PROF_BUDGET_HEIGHT  40  // One frame's budget, before scaling
+#define PROF_MAX_BUDGETS    2   // Taller bars are clipped
+
+// This array must line up with prof_scope_t
+static const char *const PROF_SCOPE_NAMES[PROF_SCOPES_COUNT] = {
+    "input",
+    "bird",
+    "bg",
+    "pipes",
+    "collision",
+    "ui",
+    "audio",
+    "draw sky",
+    "draw pipes",
+    "draw bird",
+    "draw ground",
+    "draw ui",
+    "draw fps",
+};
+
+// This array must line up with prof_scope_t
+static const uint32_t PROF_SCOPE_COLORS[PROF_SCOPES_COUNT] = {
+    0xFFFFFFFF, // input
+    0xFFD800FF, // bird
+    0x4EC0CAFF, // bg
+    0x5EE270FF, // pipes
+    0xFF6060FF, // collision
+    0xFF9C38FF, // ui
+    0xC060FFFF, // audio
+    0x2A7A86FF, // draw sky
+    0x2E8A3CFF, // draw pipes
+    0xA08800FF, // draw bird
+    0x8A6A3CFF, // draw ground
+    0xA05A20FF, // draw ui
+    0x808080FF, // draw fps
+};
+
+typedef struct prof_s
+{
+    /* Ticks spent in each scope, per frame; `frame` is still being filled */
+    uint32_t ticks[PROF_FRAMES][PROF_SCOPES_COUNT];
+    uint32_t starts[PROF_SCOPES_COUNT];
+    uint32_t frame_start;
+    uint32_t last_frame_ticks;
+    int frame;
+    int frames;
+    bool has_overrun;
+    prof_overrun_t overrun;
+} prof_t;
+
+/* Profiler implementation */
+
+static prof_t prof = {0};
+
+/* A frame overran if its vblank slot was missed, not just if it ran long */
+static void prof_check_overrun(uint32_t frame_ticks)
+{
+    const uint32_t budget_ticks = pace_get_frame_ticks();
+    if (frame_ticks <= budget_ticks + budget_ticks / 2) return;
+    const uint32_t *const ticks = prof.ticks[prof.frame];
+    prof_scope_t worst = 0;
+    for (int scope = 1; scope < PROF_SCOPES_COUNT; scope++)
+    {
+        if (ticks[scope] > ticks[worst]) worst = scope;
+    }
+    prof.overrun.frame = prof.frames;
+    prof.overrun.frame_us = TICKS_TO_US(frame_ticks);
+    prof.overrun.worst = worst;
+    prof.overrun.worst_us = TICKS_TO_US(ticks[worst]);
+    prof.has_overrun = true;
+}
+
+/* Closes the frame being timed and starts the next */
+void prof_frame(void)
+{
+    const uint32_t now = TICKS_READ();
+    if (prof.frames > 0)
+    {
+        prof.last_frame_ticks = now - prof.frame_start;
+        prof_check_overrun(prof.last_frame_ticks);
+        prof.frame = (prof.frame + 1) % PROF_FRAMES;
+    }
+    memset(prof.ticks[prof.frame], 0, sizeof(prof.ticks[prof.frame]));
+    prof.frame_start = now;
+    prof.frames++;
+}
+
+void prof_begin(prof_scope_t scope)
+{
+    prof.starts[scope] = TICKS_READ();
+}
+
+void prof_end(prof_scope_t scope)
+{
+    prof.ticks[prof.frame][scope] += TICKS_READ() - prof.starts[scope];
+}
+
+const char *prof_scope_name(prof_scope_t scope)
+{
+    return PROF_SCOPE_NAMES[scope];
+}
+
+bool prof_get_overrun(prof_overrun_t *overrun)
+{
+    *overrun = prof.overrun;
+    return prof.has_overrun;
+}
+
+/* Times for the frame prof_frame last closed */
+uint32_t prof_get_last_ticks(prof_scope_t scope)
+{
+    return prof.ticks[(prof.frame + PROF_FRAMES - 1) % PROF_FRAMES][scope];
+}
+
+uint32_t prof_get_last_frame_ticks(void)
+{
+    return prof.last_frame_ticks;
+}
+
+/*
+ * One stacked bar per finished frame, oldest on the left, with a line at
+ * the frame budget. Bars are in fill mode, so the graph costs the RDP
+ * little more than the pixels it covers.
+ */
+void prof_draw(int x, int bottom_y)
+{
+    const int bar_w = GFX_SCALE_X(PROF_BAR_WIDTH);
+    const int budget_h = GFX_SCALE_Y(PROF_BUDGET_HEIGHT);
+    const int top_y = bottom_y - budget_h * PROF_MAX_BUDGETS;
+    const float px_per_tick = (float)budget_h / pace_get_frame_ticks();
+
+    rdpq_set_mode_fill(RGBA32(0, 0, 0, 0xFF));
+    const int frames = prof.frames - 1 < PROF_FRAMES - 1 ? prof.frames - 1 : PROF_FRAMES - 1;
+    for (int i = 0; i < frames; i++)
+    {
+        /* Oldest finished frame first */
+        const int frame = (prof.frame - frames + i + PROF_FRAMES) % PROF_FRAMES;
+        const int bx = x + i * bar_w;
+        uint32_t total = 0;
+        int y = bottom_y;
+        for (int scope = 0; scope < PROF_SCOPES_COUNT && y > top_y; scope++)
+        {
+            const uint32_t ticks = prof.ticks[frame][scope];
+            if (ticks == 0) continue;
+            total += ticks;
+            int ty = bottom_y - (int)(total * px_per_tick);
+            if (ty < top_y) ty = top_y;
+            if (ty >= y) continue;
+            rdpq_set_fill_color(color_from_packed32(PROF_SCOPE_COLORS[scope]));
+            rdpq_fill_rectangle(bx, ty, bx + bar_w, y);
+            y = ty;
+        }
+    }
+
+    /* Budget line */
+    const int line_h = GFX_SCALE_Y(1);
+    rdpq_set_fill_color(RGBA32(0xFF, 0xFF, 0xFF, 0xFF));
+    rdpq_fill_rectangle(x, bottom_y - budget_h - line_h, x + PROF_FRAMES * bar_w, bottom_y - budget_h);
+}
@@ -0,0 +1,66 @@
+/**
+ * FlappyBird-N64 - prof.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_PROF_H
+#define __FLAPPY_PROF_H
+
+#include "system.h"
+
+/* Profiler definitions */
+
+#define PROF_FRAMES 64 // Frames kept in the ring and shown in the graph
+
+/* Phases of the main loop, in the order they stack in the graph */
+typedef enum
+{
+    PROF_INPUT,
+    PROF_BIRD,
+    PROF_BG,
+    PROF_PIPES,
+    PROF_COLLISION,
+    PROF_UI,
+    PROF_AUDIO,
+    PROF_DRAW_SKY,
+    PROF_DRAW_PIPES,
+    PROF_DRAW_BIRD,
+    PROF_DRAW_GROUND,
+    PROF_DRAW_UI,
+    PROF_DRAW_FPS,
+    // Additional scopes go above this line
+    PROF_SCOPES_COUNT // Not a scope; just a count
+} prof_scope_t;
+
+/* The frame that last overran its budget, and what took the longest in it */
+typedef struct prof_overrun_s
+{
+    int frame;
+    int frame_us;
+    prof_scope_t worst;
+    int worst_us;
+} prof_overrun_t;
+
+/* Profiler functions */
+
+void prof_frame(void);
+
+void prof_begin(prof_scope_t scope);
+
+void prof_end(prof_scope_t scope);
+
+const char *prof_scope_name(prof_scope_t scope);
+
+bool prof_get_overrun(prof_overrun_t *overrun);
+
+uint32_t prof_get_last_ticks(prof_scope_t scope);
+
+uint32_t prof_get_last_frame_ticks(void);
+
+void prof_draw(int x, int bottom_y);
+
+#endif
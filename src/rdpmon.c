@@ -0,0 +1,116 @@
+/**
+ * FlappyBird-N64 - rdpmon.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "rdpmon.h"
+
+/* RDP monitor definitions */
+
+#define RDPMON_LOG_FRAMES 60 // Frames summarized per debug log line
+
+typedef struct rdpmon_s
+{
+    /* Queue position at the start of the frame */
+    volatile uint32_t *queue_pointer;
+    volatile uint32_t *queue_sentinel;
+    /* CPU waits on the RDP this frame */
+    ticks_t block_ticks;
+    ticks_t blocked_ticks;
+    /* The last whole frame */
+    rdpmon_frame_t last;
+    /* Running totals for the log */
+    int log_frames;
+    rdpmon_frame_t log_sum;
+    rdpmon_frame_t log_max;
+    int log_fills;
+} rdpmon_t;
+
+/* RDP monitor implementation */
+
+static rdpmon_t rdpmon = {0};
+
+void rdpmon_init(void)
+{
+    memset(&rdpmon, 0, sizeof rdpmon);
+    rdpmon.queue_pointer = rspq_cur_pointer;
+    rdpmon.queue_sentinel = rspq_cur_sentinel;
+    rdpmon_counters_clear();
+}
+
+/*
+ * The CPU writes commands straight into the current rspq buffer, so the
+ * write pointer shows how much was queued. When a buffer fills, rspq moves
+ * on to another one and, if the RSP has not finished with it, blocks; that
+ * shows up as a change of sentinel, and the bytes across it go uncounted.
+ */
+static void rdpmon_queue_tick(void)
+{
+    rdpmon.last.filled = (rspq_cur_sentinel != rdpmon.queue_sentinel);
+    if (!rdpmon.last.filled)
+    {
+        rdpmon.last.bytes = (rspq_cur_pointer - rdpmon.queue_pointer) * sizeof(uint32_t);
+    }
+    else
+    {
+        rdpmon.last.bytes = (rdpmon.queue_sentinel - rdpmon.queue_pointer) * sizeof(uint32_t);
+    }
+    rdpmon.queue_pointer = rspq_cur_pointer;
+    rdpmon.queue_sentinel = rspq_cur_sentinel;
+}
+
+static void rdpmon_log_tick(void)
+{
+    const rdpmon_frame_t *const last = &rdpmon.last;
+    rdpmon_frame_t *const sum = &rdpmon.log_sum;
+    rdpmon_frame_t *const max = &rdpmon.log_max;
+    sum->busy_us += last->busy_us;
+    sum->bytes += last->bytes;
+    if (last->filled) rdpmon.log_fills++;
+    sum->blocked_us += last->blocked_us;
+    if (last->busy_us > max->busy_us) max->busy_us = last->busy_us;
+    if (last->bytes > max->bytes) max->bytes = last->bytes;
+    if (last->blocked_us > max->blocked_us) max->blocked_us = last->blocked_us;
+    if (++rdpmon.log_frames < RDPMON_LOG_FRAMES) return;
+
+    const int n = rdpmon.log_frames;
+    debugf("[RDP] %d frames: busy %d/%d us, queued %d/%d B, %d fills, blocked %d/%d us (avg/max)\n",
+        n, sum->busy_us / n, max->busy_us, sum->bytes / n, max->bytes,
+        rdpmon.log_fills, sum->blocked_us / n, max->blocked_us);
+    rdpmon.log_frames = 0;
+    rdpmon.log_fills = 0;
+    memset(sum, 0, sizeof *sum);
+    memset(max, 0, sizeof *max);
+}
+
+/* Closes the frame interval being measured and starts the next */
+void rdpmon_frame(void)
+{
+    const rdpmon_counters_t counters = rdpmon_counters_read();
+    rdpmon_counters_clear();
+    rdpmon.last.clock_us = RDPMON_CYCLES_TO_US(counters.clock);
+    rdpmon.last.busy_us = RDPMON_CYCLES_TO_US(counters.pipe_busy);
+    rdpmon.last.blocked_us = TICKS_TO_US(rdpmon.blocked_ticks);
+    rdpmon.blocked_ticks = 0;
+    rdpmon_queue_tick();
+    rdpmon_log_tick();
+}
+
+void rdpmon_block_begin(void)
+{
+    rdpmon.block_ticks = timer_ticks();
+}
+
+void rdpmon_block_end(void)
+{
+    rdpmon.blocked_ticks += timer_ticks() - rdpmon.block_ticks;
+}
+
+rdpmon_frame_t rdpmon_get_frame(void)
+{
+    return rdpmon.last;
+}
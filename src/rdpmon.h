@@ -0,0 +1,75 @@
+/**
+ * FlappyBird-N64 - rdpmon.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_RDPMON_H
+#define __FLAPPY_RDPMON_H
+
+#include "system.h"
+
+/* RDP monitor definitions */
+
+/* RDP command/pipeline counters (DPC_STATUS write bits clear them) */
+#define DPC_STATUS_REG          ((volatile uint32_t *)0xA410000C)
+#define DPC_CLOCK_REG           ((volatile uint32_t *)0xA4100010)
+#define DPC_BUFBUSY_REG         ((volatile uint32_t *)0xA4100014)
+#define DPC_PIPEBUSY_REG        ((volatile uint32_t *)0xA4100018)
+#define DPC_TMEM_REG            ((volatile uint32_t *)0xA410001C)
+#define DPC_CLR_COUNTERS        (0x0040 | 0x0080 | 0x0100 | 0x0200)
+#define DPC_COUNTER_MASK        0xFFFFFF
+
+/* The counters tick at the RDP clock */
+#define RDPMON_CLOCK_HZ         62500000
+#define RDPMON_CYCLES_TO_US(c)  ((int)((uint64_t)(c) * 1000000 / RDPMON_CLOCK_HZ))
+
+typedef struct rdpmon_counters_s
+{
+    uint32_t clock;     // Cycles since the last clear
+    uint32_t buf_busy;  // ...with commands waiting in the RDP's buffer
+    uint32_t pipe_busy; // ...with the pipeline working
+    uint32_t tmem;      // ...loading TMEM
+} rdpmon_counters_t;
+
+static inline void rdpmon_counters_clear(void)
+{
+    *DPC_STATUS_REG = DPC_CLR_COUNTERS;
+}
+
+static inline rdpmon_counters_t rdpmon_counters_read(void)
+{
+    return (rdpmon_counters_t){
+        .clock = *DPC_CLOCK_REG & DPC_COUNTER_MASK,
+        .buf_busy = *DPC_BUFBUSY_REG & DPC_COUNTER_MASK,
+        .pipe_busy = *DPC_PIPEBUSY_REG & DPC_COUNTER_MASK,
+        .tmem = *DPC_TMEM_REG & DPC_COUNTER_MASK,
+    };
+}
+
+/* One frame interval as the RDP and the command queue saw it */
+typedef struct rdpmon_frame_s
+{
+    int clock_us;
+    int busy_us;        // Pipeline busy
+    int bytes;          // Queued into rspq by the CPU; partial if filled
+    bool filled;        // The queue moved on to a new buffer
+    int blocked_us;     // CPU waiting for the RDP
+} rdpmon_frame_t;
+
+/* RDP monitor functions */
+
+void rdpmon_init(void);
+
+void rdpmon_frame(void);
+
+void rdpmon_block_begin(void);
+
+void rdpmon_block_end(void);
+
+rdpmon_frame_t rdpmon_get_frame(void);
+
+#endif
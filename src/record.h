@@ -0,0 +1,90 @@
+/**
+ * FlappyBird-N64 - record.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_RECORD_H
+#define __FLAPPY_RECORD_H
+
+#include <stdint.h>
+
+/*
+ * Framed binary records written into the debug channel. They share it with
+ * debugf text, so each record starts with a sync pair and ends with a
+ * checksum; a reader skips anything that doesn't frame up. Multi-byte
+ * fields are big-endian, as the N64 writes them.
+ *
+ *   sync0 sync1 type length payload[length] checksum
+ *
+ * The checksum is the low byte of the sum of type, length and payload.
+ * This header is shared with the host tools, so it only uses <stdint.h>.
+ */
+
+#define RECORD_SYNC0        0xF1
+#define RECORD_SYNC1        0xA9
+#define RECORD_HEADER_SIZE  4
+#define RECORD_MAX_PAYLOAD  255
+#define RECORD_MAX_SIZE     (RECORD_HEADER_SIZE + RECORD_MAX_PAYLOAD + 1)
+
+typedef enum
+{
+    RECORD_TYPE_FRAME = 1,
+    RECORD_TYPE_SAMPLES = 2,
+    // Additional types go above this line
+    RECORD_TYPES_END // Not a type; just past the last one
+} record_type_t;
+
+/* Phase timings carried by frame records */
+#define RECORD_FRAME_SCOPES 13
+
+// This list must line up with prof_scope_t
+#define RECORD_FRAME_SCOPE_NAMES { \
+    "input", "bird", "bg", "pipes", "collision", "ui", "audio", \
+    "draw_sky", "draw_pipes", "draw_bird", "draw_ground", "draw_ui", "draw_fps", \
+}
+
+/* One per frame, describing the frame before it */
+typedef struct __attribute__((packed)) record_frame_s
+{
+    uint32_t frame;
+    uint32_t frame_us;
+    uint8_t vblanks;
+    uint8_t bird_state;
+    uint16_t score;
+    uint16_t rdp_busy_us;
+    uint16_t rdp_blocked_us;
+    uint32_t rdp_bytes;
+    uint16_t scope_us[RECORD_FRAME_SCOPES];
+} record_frame_t;
+
+/* Program counter samples taken since the previous samples record */
+#define RECORD_SAMPLES_MAX_DEPTH 8
+
+/*
+ * Followed by `count` stacks, each a depth byte and then that many
+ * addresses (uint32_t), innermost first. The first address is the
+ * interrupted PC; the rest are return addresses.
+ */
+typedef struct __attribute__((packed)) record_samples_s
+{
+    uint16_t rate_hz;
+    uint16_t dropped;    // Samples lost to a full buffer since the last record
+    uint16_t handler_us; // Time spent taking them
+    uint8_t count;
+} record_samples_t;
+
+static inline uint8_t record_checksum(uint8_t type, uint8_t length, const uint8_t *payload)
+{
+    unsigned sum = type + length;
+    for (unsigned i = 0; i < length; i++)
+    {
+        sum += payload[i];
+    }
+    return sum & 0xFF;
+}
+
+#endif
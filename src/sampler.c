@@ -0,0 +1,151 @@
+/**
+ * FlappyBird-N64 - sampler.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "sampler.h"
+
+#include "record.h"
+#include "telem.h"
+
+/* Sampler definitions */
+
+#define SAMPLER_RING_SIZE   256 // Samples held between frames; a power of two
+#define SAMPLER_MAX_DEPTH   RECORD_SAMPLES_MAX_DEPTH
+/* backtrace() starts inside the timer interrupt; these frames are skipped */
+#define SAMPLER_HANDLER_DEPTH 8
+
+/* Room for the header plus the deepest stack, in one record */
+#define SAMPLER_STACK_BYTES(depth) (1 + (depth) * sizeof(uint32_t))
+
+typedef struct sampler_stack_s
+{
+    uint8_t depth;
+    uint32_t addrs[SAMPLER_MAX_DEPTH];
+} sampler_stack_t;
+
+typedef struct sampler_s
+{
+    int rate_hz;
+    timer_link_t *timer;
+    /* Filled by the timer interrupt, drained once per frame */
+    volatile uint32_t head;
+    uint32_t tail;
+    volatile uint32_t dropped;
+    volatile uint32_t handler_ticks;
+    sampler_stack_t ring[SAMPLER_RING_SIZE];
+} sampler_t;
+
+/* Sampler implementation */
+
+static sampler_t sampler = {
+    .rate_hz = FLAPPY_SAMPLE_HZ,
+};
+
+/*
+ * Runs in the timer interrupt, where EPC still holds the interrupted PC.
+ * Time spent in other interrupt handlers can't be sampled, since they run
+ * with interrupts disabled.
+ */
+static void sampler_timer_callback(int ovfl)
+{
+    const uint32_t start_ticks = TICKS_READ();
+    if (sampler.head - sampler.tail == SAMPLER_RING_SIZE)
+    {
+        sampler.dropped++;
+        return;
+    }
+    sampler_stack_t *const stack = &sampler.ring[sampler.head % SAMPLER_RING_SIZE];
+    const uint32_t epc = C0_READ_EPC();
+
+    /* Unwind through the interrupt frame, then keep what lies below it */
+    void *frames[SAMPLER_HANDLER_DEPTH + SAMPLER_MAX_DEPTH];
+    const int count = backtrace(frames, SAMPLER_HANDLER_DEPTH + SAMPLER_MAX_DEPTH);
+    int first = 0;
+    while (first < count && (uint32_t)(uintptr_t)frames[first] != epc)
+    {
+        first++;
+    }
+    stack->addrs[0] = epc;
+    stack->depth = 1;
+    for (int i = first + 1; i < count && stack->depth < SAMPLER_MAX_DEPTH; i++)
+    {
+        stack->addrs[stack->depth++] = (uint32_t)(uintptr_t)frames[i];
+    }
+    sampler.head++;
+    sampler.handler_ticks += TICKS_READ() - start_ticks;
+}
+
+void sampler_set_running(bool running)
+{
+    if (running == sampler_get_running()) return;
+    if (running)
+    {
+        if (sampler.rate_hz <= 0) return;
+        sampler.tail = sampler.head;
+        sampler.dropped = 0;
+        sampler.handler_ticks = 0;
+        sampler.timer = new_timer(TICKS_PER_SECOND / sampler.rate_hz, TF_CONTINUOUS,
+            sampler_timer_callback);
+        debugf("[SAMPLER] Sampling at %d Hz\n", sampler.rate_hz);
+    }
+    else
+    {
+        delete_timer(sampler.timer);
+        sampler.timer = NULL;
+        debugf("[SAMPLER] Stopped\n");
+    }
+}
+
+bool sampler_get_running(void)
+{
+    return sampler.timer != NULL;
+}
+
+/* Packs the samples taken since the last call into telemetry records */
+void sampler_write_records(void)
+{
+    if (!sampler_get_running()) return;
+
+    /* Take the counters and the current end of the ring together */
+    disable_interrupts();
+    const uint32_t head = sampler.head;
+    const uint32_t dropped = sampler.dropped;
+    const uint32_t handler_ticks = sampler.handler_ticks;
+    sampler.dropped = 0;
+    sampler.handler_ticks = 0;
+    enable_interrupts();
+
+    uint8_t payload[RECORD_MAX_PAYLOAD];
+    record_samples_t *const header = (record_samples_t *)payload;
+    const uint32_t handler_us = TICKS_TO_US(handler_ticks);
+    *header = (record_samples_t){
+        .rate_hz = sampler.rate_hz,
+        .dropped = (dropped < UINT16_MAX) ? dropped : UINT16_MAX,
+        .handler_us = (handler_us < UINT16_MAX) ? handler_us : UINT16_MAX,
+    };
+    size_t used = sizeof(record_samples_t);
+    while (sampler.tail != head)
+    {
+        const sampler_stack_t *const stack = &sampler.ring[sampler.tail % SAMPLER_RING_SIZE];
+        if (used + SAMPLER_STACK_BYTES(stack->depth) > RECORD_MAX_PAYLOAD)
+        {
+            /* Later records in the frame carry only their own samples */
+            telem_write(RECORD_TYPE_SAMPLES, payload, used);
+            header->dropped = 0;
+            header->handler_us = 0;
+            header->count = 0;
+            used = sizeof(record_samples_t);
+        }
+        payload[used++] = stack->depth;
+        memcpy(&payload[used], stack->addrs, stack->depth * sizeof(uint32_t));
+        used += stack->depth * sizeof(uint32_t);
+        header->count++;
+        sampler.tail++;
+    }
+    telem_write(RECORD_TYPE_SAMPLES, payload, used);
+}
@@ -0,0 +1,30 @@
+/**
+ * FlappyBird-N64 - sampler.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_SAMPLER_H
+#define __FLAPPY_SAMPLER_H
+
+#include "system.h"
+
+/* Sampler definitions */
+
+/* Samples per second while telemetry streams; 0 leaves the sampler off */
+#ifndef FLAPPY_SAMPLE_HZ
+#define FLAPPY_SAMPLE_HZ 0
+#endif
+
+/* Sampler functions */
+
+void sampler_set_running(bool running);
+
+bool sampler_get_running(void);
+
+void sampler_write_records(void);
+
+#endif
@@ -42,3 +42,14 @@ void sfx_play(sfx_id_t sfx_id)
 {
     mixer_ch_play(sfx_id, &SFX_CACHE[sfx_id].wave);
 }
+
+/* Mixes into any free audio buffers; cheap to call when none are free */
+void sfx_tick(void)
+{
+    if (audio_can_write())
+    {
+        short *const buf = audio_write_begin();
+        mixer_poll(buf, audio_get_buffer_length());
+        audio_write_end();
+    }
+}
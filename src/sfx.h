@@ -29,4 +29,6 @@ void sfx_init(void);
 
 void sfx_play(sfx_id_t sfx_id);
 
+void sfx_tick(void);
+
 #endif
@@ -0,0 +1,113 @@
+/**
+ * FlappyBird-N64 - telem.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "telem.h"
+
+#include "blackbox.h"
+#include "pace.h"
+#include "prof.h"
+#include "rdpmon.h"
+#include "sampler.h"
+
+/* Telemetry definitions */
+
+/* A frame's records are gathered here and written out in one go */
+#define TELEM_BUFFER_SIZE 1024
+
+_Static_assert(RECORD_FRAME_SCOPES == PROF_SCOPES_COUNT,
+    "Frame records must carry every profiler scope");
+
+typedef struct telem_s
+{
+    bool enabled;
+    int frame;
+    size_t used;
+    uint8_t buffer[TELEM_BUFFER_SIZE];
+} telem_t;
+
+/* Telemetry implementation */
+
+static telem_t telem = {0};
+
+static inline uint16_t telem_clamp16(uint32_t value)
+{
+    return (value < UINT16_MAX) ? value : UINT16_MAX;
+}
+
+void telem_tick(const joypad_buttons_t *buttons)
+{
+    /* Toggle streaming on C-right */
+    if (buttons->c_right)
+    {
+        telem.enabled = !telem.enabled;
+        debugf("[TELEM] Streaming %s\n", telem.enabled ? "on" : "off");
+        /* Profile samples travel with the frame records */
+        sampler_set_running(telem.enabled);
+        blackbox_event(BLACKBOX_EVENT_TELEM);
+    }
+}
+
+bool telem_get_enabled(void)
+{
+    return telem.enabled;
+}
+
+/* Frames a record into the buffer; flushes first if it would not fit */
+void telem_write(record_type_t type, const void *payload, size_t length)
+{
+    assert(length <= RECORD_MAX_PAYLOAD);
+    if (telem.used + RECORD_HEADER_SIZE + length + 1 > TELEM_BUFFER_SIZE)
+    {
+        telem_flush();
+    }
+    uint8_t *const record = &telem.buffer[telem.used];
+    record[0] = RECORD_SYNC0;
+    record[1] = RECORD_SYNC1;
+    record[2] = type;
+    record[3] = length;
+    memcpy(&record[RECORD_HEADER_SIZE], payload, length);
+    record[RECORD_HEADER_SIZE + length] = record_checksum(type, length, payload);
+    telem.used += RECORD_HEADER_SIZE + length + 1;
+}
+
+/* Describes the frame that just finished; call after prof_frame and rdpmon_frame */
+void telem_frame(const bird_t *bird)
+{
+    telem.frame++;
+    if (!telem.enabled) return;
+
+    const rdpmon_frame_t rdp = rdpmon_get_frame();
+    record_frame_t record = {
+        .frame = telem.frame,
+        .frame_us = TICKS_TO_US(prof_get_last_frame_ticks()),
+        .vblanks = pace_get_frame_vblanks(),
+        .bird_state = bird->state,
+        .score = telem_clamp16(bird->score),
+        .rdp_busy_us = telem_clamp16(rdp.busy_us),
+        .rdp_blocked_us = telem_clamp16(rdp.blocked_us),
+        .rdp_bytes = rdp.bytes,
+    };
+    for (int scope = 0; scope < PROF_SCOPES_COUNT; scope++)
+    {
+        record.scope_us[scope] = telem_clamp16(TICKS_TO_US(prof_get_last_ticks(scope)));
+    }
+    telem_write(RECORD_TYPE_FRAME, &record, sizeof record);
+    sampler_write_records();
+}
+
+/*
+ * stderr is where debugf goes, so records reach the same channels (USB
+ * and ISViewer) in a single unbuffered write instead of per-field text.
+ */
+void telem_flush(void)
+{
+    if (telem.used == 0) return;
+    fwrite(telem.buffer, 1, telem.used, stderr);
+    telem.used = 0;
+}
@@ -0,0 +1,29 @@
+/**
+ * FlappyBird-N64 - telem.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_TELEM_H
+#define __FLAPPY_TELEM_H
+
+#include "system.h"
+#include "record.h"
+#include "bird.h"
+
+/* Telemetry functions */
+
+void telem_tick(const joypad_buttons_t *buttons);
+
+bool telem_get_enabled(void);
+
+void telem_write(record_type_t type, const void *payload, size_t length);
+
+void telem_frame(const bird_t *bird);
+
+void telem_flush(void);
+
+#endif
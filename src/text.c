@@ -0,0 +1,80 @@
+/**
+ * FlappyBird-N64 - text.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#include "text.h"
+
+/* Text implementation */
+
+void text_init(text_t *text)
+{
+    memset(text, 0, sizeof *text);
+}
+
+void text_free(text_t *text)
+{
+    if (text->face) rdpq_paragraph_free(text->face);
+    if (text->shadow) rdpq_paragraph_free(text->shadow);
+    text->face = NULL;
+    text->shadow = NULL;
+    text->str[0] = '\0';
+}
+
+static rdpq_paragraph_t *text_build(const text_t *text, uint8_t style_id)
+{
+    const rdpq_textparms_t parms = {
+        .width = text->parms.width,
+        .align = text->parms.align,
+        .style_id = style_id,
+    };
+    int nbytes = strlen(text->str);
+    return rdpq_paragraph_build(&parms, text->font_id, text->str, &nbytes);
+}
+
+/*
+ * Lays out str unless it, the font and the parms all match the cached
+ * paragraphs. Font styles are only looked up when drawing, so recoloring a
+ * style does not need a rebuild. Returns true if the layout changed.
+ */
+bool text_set(text_t *text, int font_id, const text_parms_t *parms, const char *str)
+{
+    if (text->font_id == font_id &&
+        text->parms.width == parms->width &&
+        text->parms.align == parms->align &&
+        text->parms.style_id == parms->style_id &&
+        text->parms.shadow_style_id == parms->shadow_style_id &&
+        strcmp(text->str, str) == 0)
+    {
+        return false;
+    }
+    const size_t len = strlen(str);
+    assertf(len < sizeof(text->str), "Text too long: %s", str);
+    text_free(text);
+    text->font_id = font_id;
+    text->parms = *parms;
+    memcpy(text->str, str, len + 1);
+    if (text->str[0] == '\0') return true;
+    text->face = text_build(text, parms->style_id);
+    if (parms->shadow_style_id)
+    {
+        text->shadow = text_build(text, parms->shadow_style_id);
+    }
+    return true;
+}
+
+void text_draw(const text_t *text, int x, int y, int shadow_offset)
+{
+    if (text->shadow)
+    {
+        rdpq_paragraph_render(text->shadow, x + shadow_offset, y + shadow_offset);
+    }
+    if (text->face)
+    {
+        rdpq_paragraph_render(text->face, x, y);
+    }
+}
@@ -0,0 +1,48 @@
+/**
+ * FlappyBird-N64 - text.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __FLAPPY_TEXT_H
+#define __FLAPPY_TEXT_H
+
+#include "system.h"
+
+/* Text definitions */
+
+#define TEXT_MAX_LENGTH 64
+
+/* Everything that affects layout; changing any of it rebuilds the text */
+typedef struct text_parms_s
+{
+    int width;
+    rdpq_align_t align;
+    uint8_t style_id;
+    uint8_t shadow_style_id; /* 0 draws no shadow */
+} text_parms_t;
+
+/* A string laid out once into paragraphs and redrawn from the cached glyphs */
+typedef struct text_s
+{
+    int font_id;
+    text_parms_t parms;
+    char str[TEXT_MAX_LENGTH];
+    rdpq_paragraph_t *face;
+    rdpq_paragraph_t *shadow;
+} text_t;
+
+/* Text functions */
+
+void text_init(text_t *text);
+
+void text_free(text_t *text);
+
+bool text_set(text_t *text, int font_id, const text_parms_t *parms, const char *str);
+
+void text_draw(const text_t *text, int x, int y, int shadow_offset);
+
+#endif
@@ -10,13 +10,22 @@
 #include "ui.h"
 
 #include "system.h"
+#include "atlas.h"
+#include "atlas-digits.h"
+#include "atlas-ui.h"
+#include "digits.h"
 #include "gfx.h"
+#include "panel.h"
+#include "text.h"
 #include "sfx.h"
 #include "bg.h"
+#include "blackbox.h"
 #include "bird.h"
 #include "fps.h"
+#include "pace.h"
 
 #include <eeprom.h>
+#include <math.h>
 
 /* UI definitions */
 
@@ -25,8 +34,6 @@
 #define ROM_VERSION ""
 #endif
 
-#define UI_SCORE_MAX_DIGITS     ((size_t)5)
-
 #define UI_DEATH_FLASH_TICKS    ((uint64_t)150 * TICKS_PER_MS)
 #define UI_DEATH_HEADING_DELAY  ((int)600 * TICKS_PER_MS)
 #define UI_DEATH_BOARD_DELAY    ((int)1500 * TICKS_PER_MS)
@@ -63,6 +70,8 @@ typedef enum
     MENU_ROW_COLOR,
     MENU_ROW_SCENE,
     MENU_ROW_HIRES,
+    MENU_ROW_WIDE,
+    MENU_ROW_PACE,
     MENU_ROW_FPS,
     MENU_ROW_COUNT,
 } menu_row_t;
@@ -81,32 +90,46 @@ typedef enum
     UI_SPRITE_HEADINGS,
     UI_SPRITE_HOWTO,
     UI_SPRITE_SCOREBOARD,
-    UI_SPRITE_MEDAL_BRONZE,
-    UI_SPRITE_MEDAL_SILVER,
-    UI_SPRITE_MEDAL_GOLD,
-    UI_SPRITE_MEDAL_PLATINUM,
-    UI_SPRITE_FONT_LARGE,
-    UI_SPRITE_FONT_MED,
-    UI_SPRITE_NEW,
-    UI_SPRITE_SPARKLE,
     // Additional sprites go above this line
     UI_SPRITES_COUNT, // Not an actual sprite, just a handy counter
 } ui_sprite_t;
 
+typedef enum
+{
+    UI_CREDIT_GAME,
+    UI_CREDIT_PORT,
+    UI_CREDIT_VERSION,
+    // Additional credits go above this line
+    UI_CREDITS_COUNT, // Not an actual credit, just a handy counter
+} ui_credit_t;
+
+// This array must line up with ui_credit_t
+static const char *const UI_CREDIT_STRINGS[UI_CREDITS_COUNT] = {
+    "Game by .GEARS",
+    "N64 Port by Meeq",
+    ROM_VERSION,
+};
+
 // This array must line up with ui_sprite_t
 static const char *const UI_SPRITE_FILES[UI_SPRITES_COUNT] = {
     "rom:/gfx/logo.sprite",
     "rom:/gfx/headings.sprite",
     "rom:/gfx/how-to.sprite",
     "rom:/gfx/scoreboard.sprite",
-    "rom:/gfx/medal-bronze.sprite",
-    "rom:/gfx/medal-silver.sprite",
-    "rom:/gfx/medal-gold.sprite",
-    "rom:/gfx/medal-platinum.sprite",
-    "rom:/gfx/font-large.sprite",
-    "rom:/gfx/font-medium.sprite",
-    "rom:/gfx/new.sprite",
-    "rom:/gfx/sparkle.sprite",
+};
+
+/*
+ * Each medal has an atlas-ui page of its own, shared with the new badge and
+ * sparkle so that everything drawn beside it comes from one TMEM load.
+ */
+#define UI_MEDAL_NONE ATLAS_UI_PAGES_COUNT
+
+// This array must line up with atlas_ui_page_t
+static const atlas_ui_rect_t UI_MEDAL_RECTS[ATLAS_UI_PAGES_COUNT] = {
+    ATLAS_UI_MEDAL_BRONZE,
+    ATLAS_UI_MEDAL_SILVER,
+    ATLAS_UI_MEDAL_GOLD,
+    ATLAS_UI_MEDAL_PLATINUM,
 };
 
 typedef struct ui_s
@@ -121,6 +144,12 @@ typedef struct ui_s
     color_t text_color;
     color_t shadow_color;
     sprite_t *sprites[UI_SPRITES_COUNT];
+    atlas_t *atlas;
+    atlas_t *digits_atlas;
+    /* Score digits, decomposed only when the values change */
+    digits_t score_digits;
+    digits_t last_digits;
+    digits_t high_digits;
     /* Death */
     bool did_flash;
     bool flash_draw;
@@ -146,10 +175,21 @@ typedef struct ui_s
     /* Title screen menu */
     int menu_row;
     bird_color_t bird_color;
+    /* Title screen text, laid out only when it changes */
+    text_t credit_texts[UI_CREDITS_COUNT];
+    text_t menu_texts[MENU_ROW_COUNT];
+    int menu_values[MENU_ROW_COUNT];
+    /* Static panels, composited offscreen once their content settles */
+    panel_t title_panel;
+    panel_t gameover_panel;
+    float panels_scale_x;
+    float panels_scale_y;
 } ui_t;
 
 /* Forward declarations */
 static void ui_randomize_sparkle_position(ui_t *ui);
+static void ui_title_text_tick(ui_t *ui);
+static void ui_panels_tick(ui_t *ui);
 
 /* EEPROM high score persistence */
 
@@ -200,6 +240,7 @@ static void ui_save_high_score(const ui_t *ui)
     data[7] = ui->high_score & 0xFF;
 
     eeprom_write(0, data);
+    blackbox_event(BLACKBOX_EVENT_SAVE);
     debugf("[EEPROM] Saved high score: %d\n", ui->high_score);
 }
 
@@ -210,6 +251,8 @@ static void ui_set_time_mode(ui_t *ui, bg_time_mode_t time_mode)
     ui->time_mode = time_mode;
     ui->text_color = UI_LIGHT_COLOR;
     ui->shadow_color = UI_DARK_COLOR;
+    panel_free(&ui->title_panel);
+    panel_free(&ui->gameover_panel);
     /* Update font styles for current time mode (both 1x and 2x fonts) */
     rdpq_font_t *font_1x = (rdpq_font_t *)rdpq_text_get_font(FONT_AT01);
     rdpq_font_t *font_2x = (rdpq_font_t *)rdpq_text_get_font(FONT_AT01_2X);
@@ -243,6 +286,22 @@ ui_t *ui_init(void)
     {
         ui->sprites[i] = sprite_load(UI_SPRITE_FILES[i]);
     }
+    ui->atlas = atlas_load(ATLAS_UI_NAME, ATLAS_UI_PAGES, ATLAS_UI_PAGES_COUNT,
+        &ATLAS_UI_RECTS[0][0], ATLAS_UI_RECTS_COUNT);
+    ui->digits_atlas = atlas_load(ATLAS_DIGITS_NAME, ATLAS_DIGITS_PAGES, ATLAS_DIGITS_PAGES_COUNT,
+        &ATLAS_DIGITS_RECTS[0][0], ATLAS_DIGITS_RECTS_COUNT);
+    digits_init(&ui->score_digits);
+    digits_init(&ui->last_digits);
+    digits_init(&ui->high_digits);
+    for (size_t i = 0; i < UI_CREDITS_COUNT; i++)
+    {
+        text_init(&ui->credit_texts[i]);
+    }
+    for (size_t i = 0; i < MENU_ROW_COUNT; i++)
+    {
+        text_init(&ui->menu_texts[i]);
+        ui->menu_values[i] = -1;
+    }
     return ui;
 }
 
@@ -253,6 +312,20 @@ void ui_free(ui_t *ui)
         sprite_free(ui->sprites[i]);
         ui->sprites[i] = NULL;
     }
+    atlas_free(ui->atlas);
+    ui->atlas = NULL;
+    atlas_free(ui->digits_atlas);
+    ui->digits_atlas = NULL;
+    for (size_t i = 0; i < UI_CREDITS_COUNT; i++)
+    {
+        text_free(&ui->credit_texts[i]);
+    }
+    for (size_t i = 0; i < MENU_ROW_COUNT; i++)
+    {
+        text_free(&ui->menu_texts[i]);
+    }
+    panel_free(&ui->title_panel);
+    panel_free(&ui->gameover_panel);
     free(ui);
 }
 
@@ -417,67 +490,53 @@ void ui_tick(ui_t *ui, const bird_t *bird)
     ui_bird_tick(ui, bird);
     ui_flash_tick(ui);
     ui_gameover_tick(ui);
+    digits_set(&ui->score_digits, ui->last_score);
+    digits_set(&ui->last_digits, ui->last_score_acc);
+    digits_set(&ui->high_digits, ui->high_score);
+    ui_title_text_tick(ui);
+    ui_panels_tick(ui);
 }
 
 /* Below this point there be magic numbers! */
 
-static void ui_logo_draw(const ui_t *ui)
+static void ui_logo_draw(const ui_t *ui, int dx, int dy)
 {
     sprite_t *const logo = ui->sprites[UI_SPRITE_LOGO];
 
     const int center_x = (gfx->width / 2);
     const int center_y = (gfx->height / 2);
-    const int logo_x = center_x - GFX_SCALE(logo->width / 2);
-    const int logo_y = center_y - GFX_SCALE(logo->height * 3.5);
+    const int logo_x = center_x - GFX_SCALE_X(logo->width / 2);
+    const int logo_y = center_y - GFX_SCALE_Y(logo->height * 3.5);
 
     /* Draw logo sprite */
     rdpq_set_mode_standard();
     rdpq_mode_alphacompare(1);
-    rdpq_sprite_blit(logo, logo_x, logo_y, &(rdpq_blitparms_t){
-        .scale_x = gfx->scale,
-        .scale_y = gfx->scale,
+    rdpq_sprite_blit(logo, logo_x + dx, logo_y + dy, &(rdpq_blitparms_t){
+        .scale_x = gfx->scale_x,
+        .scale_y = gfx->scale_y,
     });
 
-    /* Select font based on resolution */
-    const int font_id = gfx->highres ? FONT_AT01_2X : FONT_AT01;
-    const int shadow_offset = GFX_SCALE(1);
-    const int line_h = GFX_SCALE(16);
+    const int shadow_offset = GFX_SCALE_Y(1);
+    const int line_h = GFX_SCALE_Y(16);
 
     /* Credits positioned at right side, right-aligned */
     const int credits_x = gfx->width / 2;
-    const int credits_w = gfx->width / 2 - GFX_SCALE(32);
-    const int credit1_y = gfx->height / 2 + GFX_SCALE(5) + line_h;
-    const int credit2_y = credit1_y + line_h;
-    const int version_y = credit2_y + line_h;
-
-    const char *const credit1_str = "Game by .GEARS";
-    const char *const credit2_str = "N64 Port by Meeq";
-    const char *const version_str = ROM_VERSION;
-
-    /* Draw shadows then text for credits (right-aligned) */
-    rdpq_textparms_t shadow_parms = { .style_id = UI_STYLE_SHADOW, .width = credits_w, .align = ALIGN_RIGHT };
-    rdpq_textparms_t text_parms = { .style_id = UI_STYLE_TEXT, .width = credits_w, .align = ALIGN_RIGHT };
+    const int credits_y = gfx->height / 2 + GFX_SCALE_Y(5) + line_h;
 
-    rdpq_text_print(&shadow_parms, font_id, credits_x + shadow_offset, credit1_y + shadow_offset, credit1_str);
-    rdpq_text_print(&shadow_parms, font_id, credits_x + shadow_offset, credit2_y + shadow_offset, credit2_str);
-    rdpq_text_print(&text_parms, font_id, credits_x, credit1_y, credit1_str);
-    rdpq_text_print(&text_parms, font_id, credits_x, credit2_y, credit2_str);
-
-    if (version_str[0])
+    for (size_t i = 0; i < UI_CREDITS_COUNT; i++)
     {
-        rdpq_text_print(&shadow_parms, font_id, credits_x + shadow_offset, version_y + shadow_offset, version_str);
-        rdpq_text_print(&text_parms, font_id, credits_x, version_y, version_str);
+        text_draw(&ui->credit_texts[i], credits_x + dx, credits_y + (i * line_h) + dy, shadow_offset);
     }
 }
 
-static void ui_heading_draw(const ui_t *ui, int stride)
+static void ui_heading_draw(const ui_t *ui, int stride, int dx, int dy)
 {
     sprite_t *const headings = ui->sprites[UI_SPRITE_HEADINGS];
 
     const int center_x = (gfx->width / 2);
     const int center_y = (gfx->height / 2);
-    const int x = center_x - GFX_SCALE(headings->width / 2);
-    const int y = center_y - GFX_SCALE(70);
+    const int x = center_x - GFX_SCALE_X(headings->width / 2);
+    const int y = center_y - GFX_SCALE_Y(70);
 
     /* Calculate slice dimensions for strided sprite */
     const int slice_h = headings->height / headings->vslices;
@@ -485,11 +544,11 @@ static void ui_heading_draw(const ui_t *ui, int stride)
 
     rdpq_set_mode_standard();
     rdpq_mode_alphacompare(1);
-    rdpq_sprite_blit(headings, x, y, &(rdpq_blitparms_t){
+    rdpq_sprite_blit(headings, x + dx, y + dy, &(rdpq_blitparms_t){
         .t0 = t_offset,
         .height = slice_h,
-        .scale_x = gfx->scale,
-        .scale_y = gfx->scale,
+        .scale_x = gfx->scale_x,
+        .scale_y = gfx->scale_y,
     });
 }
 
@@ -499,101 +558,74 @@ static void ui_howto_draw(const ui_t *ui)
 
     const int center_x = (gfx->width / 2);
     const int center_y = (gfx->height / 2);
-    const int x = center_x - GFX_SCALE(howto->width / 2);
-    const int y = center_y - GFX_SCALE(howto->height / 1.45);
+    const int x = center_x - GFX_SCALE_X(howto->width / 2);
+    const int y = center_y - GFX_SCALE_Y(howto->height / 1.45);
 
     rdpq_set_mode_standard();
     rdpq_mode_alphacompare(1);
     rdpq_sprite_blit(howto, x, y, &(rdpq_blitparms_t){
-        .scale_x = gfx->scale,
-        .scale_y = gfx->scale,
+        .scale_x = gfx->scale_x,
+        .scale_y = gfx->scale_y,
     });
 }
 
 static void ui_score_draw(const ui_t *ui)
 {
-    uint16_t score = ui->last_score;
-    sprite_t *const font = ui->sprites[UI_SPRITE_FONT_LARGE];
-
-    size_t i = 0, num_digits;
-    int digits[UI_SCORE_MAX_DIGITS];
-    do
-    {
-        digits[i] = score % 10;
-        score /= 10;
-        num_digits = ++i;
-    } while (score != 0 && num_digits < UI_SCORE_MAX_DIGITS);
-
-    const int digit_w = font->width / font->hslices;
-    const int digit_h = font->height / font->vslices;
-    const int scaled_digit_w = GFX_SCALE(digit_w);
-    const int score_w = scaled_digit_w * num_digits;
+    const int score_w = digits_width(&ui->score_digits, ui->digits_atlas, ATLAS_DIGITS_FONT_LARGE);
     const int center_x = gfx->width / 2;
-    const int y = GFX_SCALE(20);
+    const int y = GFX_SCALE_Y(20);
 
-    rdpq_set_mode_standard();
-    rdpq_mode_alphacompare(1);
-
-    int x = center_x + (score_w / 2) - scaled_digit_w;
-    for (i = 0; i < num_digits; i++)
-    {
-        const int s_offset = digits[i] * digit_w;
-        rdpq_sprite_blit(font, x, y, &(rdpq_blitparms_t){
-            .s0 = s_offset,
-            .width = digit_w,
-            .height = digit_h,
-            .scale_x = gfx->scale,
-            .scale_y = gfx->scale,
-        });
-        x -= scaled_digit_w;
-    }
+    digits_begin(ui->digits_atlas);
+    digits_draw(&ui->score_digits, ui->digits_atlas, ATLAS_DIGITS_FONT_LARGE,
+        center_x + (score_w / 2), y);
 }
 
-static void ui_scoreboard_draw(const ui_t *ui)
+static void ui_scoreboard_draw(const ui_t *ui, int dx, int dy)
 {
     sprite_t *const scoreboard = ui->sprites[UI_SPRITE_SCOREBOARD];
 
     const int center_x = (gfx->width / 2);
-    const int x = center_x - GFX_SCALE(scoreboard->width / 2);
+    const int x = center_x - GFX_SCALE_X(scoreboard->width / 2);
 
     /* Compute Y position from normalized factor */
     const int max_y = gfx->height;
     const int center_y = max_y / 2;
-    const int min_y = center_y - GFX_SCALE(scoreboard->height / 2);
+    const int min_y = center_y - GFX_SCALE_Y(scoreboard->height / 2);
     const int y_diff = max_y - min_y;
     const int board_y = min_y + (int)(y_diff * ui->board_y_factor);
 
     rdpq_set_mode_standard();
     rdpq_mode_alphacompare(1);
-    rdpq_sprite_blit(scoreboard, x, board_y, &(rdpq_blitparms_t){
-        .scale_x = gfx->scale,
-        .scale_y = gfx->scale,
+    rdpq_sprite_blit(scoreboard, x + dx, board_y + dy, &(rdpq_blitparms_t){
+        .scale_x = gfx->scale_x,
+        .scale_y = gfx->scale_y,
     });
 }
 
-static sprite_t *ui_get_medal_sprite(const ui_t *ui)
+static atlas_ui_page_t ui_get_medal(const ui_t *ui)
 {
     const int score = ui->last_score;
     if (score >= UI_MEDAL_SCORE_PLATINUM)
-        return ui->sprites[UI_SPRITE_MEDAL_PLATINUM];
+        return ATLAS_UI_PAGE_MEDAL_PLATINUM;
     else if (score >= UI_MEDAL_SCORE_GOLD)
-        return ui->sprites[UI_SPRITE_MEDAL_GOLD];
+        return ATLAS_UI_PAGE_MEDAL_GOLD;
     else if (score >= UI_MEDAL_SCORE_SILVER)
-        return ui->sprites[UI_SPRITE_MEDAL_SILVER];
+        return ATLAS_UI_PAGE_MEDAL_SILVER;
     else if (score >= UI_MEDAL_SCORE_BRONZE)
-        return ui->sprites[UI_SPRITE_MEDAL_BRONZE];
+        return ATLAS_UI_PAGE_MEDAL_BRONZE;
     else
-        return NULL;
+        return UI_MEDAL_NONE;
 }
 
 static void ui_randomize_sparkle_position(ui_t *ui)
 {
-    sprite_t *const medal = ui_get_medal_sprite(ui);
-    sprite_t *const sparkle = ui->sprites[UI_SPRITE_SPARKLE];
-    if (medal == NULL) return;
+    const atlas_ui_page_t page = ui_get_medal(ui);
+    if (page == UI_MEDAL_NONE) return;
+    const atlas_rect_t *const medal = atlas_get_rect(ui->atlas, page, UI_MEDAL_RECTS[page]);
+    const atlas_rect_t *const sparkle = atlas_get_rect(ui->atlas, page, ATLAS_UI_SPARKLE);
 
-    const int sparkle_w = sparkle->width / sparkle->hslices;
-    const int sparkle_h = sparkle->height;
+    const int sparkle_w = atlas_rect_slice_w(sparkle);
+    const int sparkle_h = atlas_rect_slice_h(sparkle);
     const int range_x = medal->width - sparkle_w;
     const int range_y = medal->height - sparkle_h;
 
@@ -601,26 +633,17 @@ static void ui_randomize_sparkle_position(ui_t *ui)
     ui->sparkle_y = ((float)rand() / (float)RAND_MAX) * range_y;
 }
 
-static void ui_medal_draw(const ui_t *ui)
+static void ui_medal_position(const atlas_rect_t *medal, int *x, int *y)
 {
-    sprite_t *const medal = ui_get_medal_sprite(ui);
-    if (medal == NULL)
-        return;
-
     const int center_x = (gfx->width / 2);
     const int center_y = (gfx->height / 2);
-    const int x = center_x - GFX_SCALE(medal->width / 2) - GFX_SCALE(32);
-    const int y = center_y - GFX_SCALE(medal->height / 2) + GFX_SCALE(4);
-
-    rdpq_set_mode_standard();
-    rdpq_mode_alphacompare(1);
-    rdpq_sprite_blit(medal, x, y, &(rdpq_blitparms_t){
-        .scale_x = gfx->scale,
-        .scale_y = gfx->scale,
-    });
+    *x = center_x - GFX_SCALE_X(medal->width / 2) - GFX_SCALE_X(32);
+    *y = center_y - GFX_SCALE_Y(medal->height / 2) + GFX_SCALE_Y(4);
+}
 
-    /* Draw sparkle animation */
-    sprite_t *const sparkle = ui->sprites[UI_SPRITE_SPARKLE];
+/* Expects the medal's page to be loaded already */
+static void ui_sparkle_frame_draw(const ui_t *ui, atlas_ui_page_t page, int x, int y)
+{
     const int64_t now_ticks = get_ticks();
     const int elapsed = now_ticks - ui->sparkle_ticks;
 
@@ -630,75 +653,74 @@ static void ui_medal_draw(const ui_t *ui)
     const int frame_map[] = {0, 1, 2, 1, 0};
     const int frame = frame_map[phase];
 
-    const int sparkle_w = sparkle->width / sparkle->hslices;
-    const int sparkle_x = x + GFX_SCALE(ui->sparkle_x);
-    const int sparkle_y = y + GFX_SCALE(ui->sparkle_y);
+    const int sparkle_x = x + GFX_SCALE_X(ui->sparkle_x);
+    const int sparkle_y = y + GFX_SCALE_Y(ui->sparkle_y);
 
-    rdpq_sprite_blit(sparkle, sparkle_x, sparkle_y, &(rdpq_blitparms_t){
-        .s0 = frame * sparkle_w,
-        .width = sparkle_w,
-        .height = sparkle->height,
-        .scale_x = gfx->scale,
-        .scale_y = gfx->scale,
-    });
+    atlas_draw(ui->atlas, page, ATLAS_UI_SPARKLE, frame, 0, sparkle_x, sparkle_y);
 }
 
-static void ui_highscores_score_draw(const ui_t *ui, int score, int y)
+/* The medal, its sparkle and the new badge, all from one page of atlas-ui */
+static void ui_medal_draw(const ui_t *ui, int dx, int dy, bool sparkle)
 {
-    sprite_t *const font = ui->sprites[UI_SPRITE_FONT_MED];
+    const atlas_ui_page_t medal_page = ui_get_medal(ui);
+    const bool new_draw = ui->new_high_score && ui->last_score_acc == ui->last_score;
+    if (medal_page == UI_MEDAL_NONE && !new_draw)
+        return;
+    /* A high score too low for a medal still needs the new badge from some page */
+    const atlas_ui_page_t page = (medal_page != UI_MEDAL_NONE) ? medal_page : ATLAS_UI_PAGE_MEDAL_BRONZE;
+    atlas_begin(ui->atlas, page);
 
-    size_t i = 0, num_digits;
-    int digits[UI_SCORE_MAX_DIGITS] = {0};
-    do
+    if (medal_page != UI_MEDAL_NONE)
     {
-        digits[i] = score % 10;
-        score /= 10;
-        num_digits = ++i;
-    } while (score != 0 && num_digits < UI_SCORE_MAX_DIGITS);
-
-    const int digit_w = font->width / font->hslices;
-    const int digit_h = font->height / font->vslices;
-    const int scaled_digit_w = GFX_SCALE(digit_w);
-    const int center_x = gfx->width / 2;
-
-    rdpq_set_mode_standard();
-    rdpq_mode_alphacompare(1);
+        const atlas_rect_t *const medal = atlas_get_rect(ui->atlas, page, UI_MEDAL_RECTS[page]);
+        int x, y;
+        ui_medal_position(medal, &x, &y);
+        atlas_draw(ui->atlas, page, UI_MEDAL_RECTS[page], 0, 0, x + dx, y + dy);
+        if (sparkle)
+        {
+            ui_sparkle_frame_draw(ui, page, x + dx, y + dy);
+        }
+    }
 
-    int x = center_x + GFX_SCALE(38);
-    for (i = 0; i < num_digits; i++)
+    if (new_draw)
     {
-        const int s_offset = digits[i] * digit_w;
-        rdpq_sprite_blit(font, x, y, &(rdpq_blitparms_t){
-            .s0 = s_offset,
-            .width = digit_w,
-            .height = digit_h,
-            .scale_x = gfx->scale,
-            .scale_y = gfx->scale,
-        });
-        x -= scaled_digit_w;
+        const int center_x = (gfx->width / 2);
+        const int center_y = (gfx->height / 2);
+        const int new_x = center_x + GFX_SCALE_X(10);
+        const int new_y = center_y + GFX_SCALE_Y(1);
+        atlas_draw(ui->atlas, page, ATLAS_UI_NEW, 0, 0, new_x + dx, new_y + dy);
     }
 }
 
-static void ui_highscores_draw(const ui_t *ui)
+/* Just the sparkle, over a game over panel that already has the medal */
+static void ui_sparkle_draw(const ui_t *ui)
 {
-    const int center_x = (gfx->width / 2);
-    const int center_y = (gfx->height / 2);
-    ui_highscores_score_draw(ui, ui->last_score_acc, center_y - GFX_SCALE(11));
-    ui_highscores_score_draw(ui, ui->high_score, center_y + GFX_SCALE(10));
+    const atlas_ui_page_t page = ui_get_medal(ui);
+    if (page == UI_MEDAL_NONE)
+        return;
+    const atlas_rect_t *const medal = atlas_get_rect(ui->atlas, page, UI_MEDAL_RECTS[page]);
 
-    if (ui->new_high_score && ui->last_score_acc == ui->last_score)
-    {
-        sprite_t *const new_sprite = ui->sprites[UI_SPRITE_NEW];
-        const int new_x = center_x + GFX_SCALE(10);
-        const int new_y = center_y + GFX_SCALE(1);
+    int x, y;
+    ui_medal_position(medal, &x, &y);
 
-        rdpq_set_mode_standard();
-        rdpq_mode_alphacompare(1);
-        rdpq_sprite_blit(new_sprite, new_x, new_y, &(rdpq_blitparms_t){
-            .scale_x = gfx->scale,
-            .scale_y = gfx->scale,
-        });
-    }
+    atlas_begin(ui->atlas, page);
+    ui_sparkle_frame_draw(ui, page, x, y);
+}
+
+static void ui_highscores_draw(const ui_t *ui, int dx, int dy)
+{
+    const atlas_rect_t *const font =
+        atlas_get_rect(ui->digits_atlas, ATLAS_PAGE_ALL, ATLAS_DIGITS_FONT_MEDIUM);
+    const int center_x = (gfx->width / 2);
+    const int center_y = (gfx->height / 2);
+    const int right_x = center_x + GFX_SCALE_X(38) + GFX_SCALE_X(atlas_rect_slice_w(font)) + dx;
+
+    /* Both scores come from a single upload of the digits atlas */
+    digits_begin(ui->digits_atlas);
+    digits_draw(&ui->last_digits, ui->digits_atlas, ATLAS_DIGITS_FONT_MEDIUM,
+        right_x, center_y - GFX_SCALE_Y(11) + dy);
+    digits_draw(&ui->high_digits, ui->digits_atlas, ATLAS_DIGITS_FONT_MEDIUM,
+        right_x, center_y + GFX_SCALE_Y(10) + dy);
 }
 
 static void ui_flash_draw(const ui_t *ui)
@@ -710,11 +732,190 @@ static void ui_flash_draw(const ui_t *ui)
     rdpq_fill_rectangle(0, 0, gfx->width, gfx->height);
 }
 
+/* Static panels */
+
+static void ui_title_panel_compose(ui_t *ui)
+{
+    sprite_t *const logo = ui->sprites[UI_SPRITE_LOGO];
+    const int center_x = (gfx->width / 2);
+    const int center_y = (gfx->height / 2);
+    const int shadow_offset = GFX_SCALE_Y(1);
+    const int line_h = GFX_SCALE_Y(16);
+
+    panel_rect_t rect = PANEL_RECT_EMPTY;
+    panel_rect_add(&rect,
+        center_x - GFX_SCALE_X(logo->width / 2), center_y - GFX_SCALE_Y(logo->height * 3.5),
+        GFX_SCALE_X(logo->width), GFX_SCALE_Y(logo->height));
+    /* Paragraph bounding boxes are relative to where they are drawn */
+    const int credits_y = center_y + GFX_SCALE_Y(5) + line_h;
+    for (size_t i = 0; i < UI_CREDITS_COUNT; i++)
+    {
+        const rdpq_paragraph_t *const face = ui->credit_texts[i].face;
+        if (face == NULL) continue;
+        const int x = center_x + floorf(face->bbox.x0);
+        const int y = credits_y + (i * line_h) + floorf(face->bbox.y0);
+        panel_rect_add(&rect, x, y,
+            ceilf(face->bbox.x1 - face->bbox.x0) + shadow_offset + 1,
+            ceilf(face->bbox.y1 - face->bbox.y0) + shadow_offset + 1);
+    }
+
+    if (!panel_begin(&ui->title_panel, &rect)) return;
+    ui_logo_draw(ui, -ui->title_panel.x, -ui->title_panel.y);
+    panel_end(&ui->title_panel);
+}
+
+/* Everything on the game over screen except the medal sparkle */
+static void ui_gameover_panel_compose(ui_t *ui)
+{
+    sprite_t *const scoreboard = ui->sprites[UI_SPRITE_SCOREBOARD];
+    sprite_t *const headings = ui->sprites[UI_SPRITE_HEADINGS];
+    const int center_x = (gfx->width / 2);
+    const int center_y = (gfx->height / 2);
+
+    panel_rect_t rect = PANEL_RECT_EMPTY;
+    panel_rect_add(&rect,
+        center_x - GFX_SCALE_X(headings->width / 2), center_y - GFX_SCALE_Y(70),
+        GFX_SCALE_X(headings->width), GFX_SCALE_Y(headings->height / headings->vslices));
+    panel_rect_add(&rect,
+        center_x - GFX_SCALE_X(scoreboard->width / 2), center_y - GFX_SCALE_Y(scoreboard->height / 2),
+        GFX_SCALE_X(scoreboard->width), GFX_SCALE_Y(scoreboard->height));
+
+    if (!panel_begin(&ui->gameover_panel, &rect)) return;
+    const int dx = -ui->gameover_panel.x;
+    const int dy = -ui->gameover_panel.y;
+    ui_heading_draw(ui, UI_HEADING_GAME_OVER, dx, dy);
+    ui_scoreboard_draw(ui, dx, dy);
+    ui_highscores_draw(ui, dx, dy);
+    ui_medal_draw(ui, dx, dy, false);
+    panel_end(&ui->gameover_panel);
+}
+
+/*
+ * Panels are composited on the first tick their screen is static, and
+ * dropped when it goes away or when the resolution or time mode changes.
+ */
+static void ui_panels_tick(ui_t *ui)
+{
+    if (ui->panels_scale_x != gfx->scale_x || ui->panels_scale_y != gfx->scale_y)
+    {
+        panel_free(&ui->title_panel);
+        panel_free(&ui->gameover_panel);
+        ui->panels_scale_x = gfx->scale_x;
+        ui->panels_scale_y = gfx->scale_y;
+    }
+
+    if (ui->state != BIRD_STATE_TITLE)
+    {
+        panel_free(&ui->title_panel);
+    }
+    else if (!panel_is_valid(&ui->title_panel))
+    {
+        ui_title_panel_compose(ui);
+    }
+
+    if (!ui->did_gameover)
+    {
+        panel_free(&ui->gameover_panel);
+    }
+    else if (!panel_is_valid(&ui->gameover_panel))
+    {
+        ui_gameover_panel_compose(ui);
+    }
+}
+
 /* Title screen menu */
 
 static const char *const MENU_COLOR_NAMES[] = {"Yellow", "Blue", "Red"};
 static const char *const MENU_SCENE_NAMES[] = {"Day", "Night"};
 static const char *const MENU_BOOL_NAMES[] = {"No", "Yes"};
+// This array must line up with gfx_res_mode_t
+static const char *const MENU_RES_NAMES[] = {"No", "Yes", "Field", "Auto"};
+
+/* Pacing choices run from the full rate with the most buffers downwards */
+#define MENU_PACE_BUFFER_CHOICES (GFX_BUFFERS_MAX - GFX_BUFFERS_MIN + 1)
+#define MENU_PACE_COUNT (PACE_RATES_COUNT * MENU_PACE_BUFFER_CHOICES)
+
+static int ui_menu_pace_value(void)
+{
+    return pace_get_rate() * MENU_PACE_BUFFER_CHOICES + (GFX_BUFFERS_MAX - gfx_get_buffers());
+}
+
+static void ui_menu_format_row(char *line, size_t size, menu_row_t row, bool focused, int value)
+{
+    const char *prefix = focused ? "> " : "  ";
+    switch (row)
+    {
+    case MENU_ROW_COLOR:
+        snprintf(line, size, "%sColor: %s", prefix, MENU_COLOR_NAMES[value]);
+        break;
+    case MENU_ROW_SCENE:
+        snprintf(line, size, "%sScene: %s", prefix, MENU_SCENE_NAMES[value]);
+        break;
+    case MENU_ROW_HIRES:
+        snprintf(line, size, "%sHi-Res: %s", prefix, MENU_RES_NAMES[value]);
+        break;
+    case MENU_ROW_WIDE:
+        snprintf(line, size, "%sWidescreen: %s", prefix, MENU_BOOL_NAMES[value]);
+        break;
+    case MENU_ROW_PACE:
+        snprintf(line, size, "%sPacing: %d Hz x%d", prefix, pace_get_hz(), gfx_get_buffers());
+        break;
+    case MENU_ROW_FPS:
+        snprintf(line, size, "%sShow FPS: %s", prefix, MENU_BOOL_NAMES[value]);
+        break;
+    default:
+        line[0] = '\0';
+        break;
+    }
+}
+
+/* Re-lay-out title text only when a value, the focus or the resolution changes */
+static void ui_title_text_tick(ui_t *ui)
+{
+    if (ui->state != BIRD_STATE_TITLE) return;
+
+    const int font_id = gfx_font_id();
+
+    const text_parms_t credit_parms = {
+        .width = gfx->width / 2 - GFX_SCALE_X(32),
+        .align = ALIGN_RIGHT,
+        .style_id = UI_STYLE_TEXT,
+        .shadow_style_id = UI_STYLE_SHADOW,
+    };
+    for (size_t i = 0; i < UI_CREDITS_COUNT; i++)
+    {
+        text_set(&ui->credit_texts[i], font_id, &credit_parms, UI_CREDIT_STRINGS[i]);
+    }
+
+    const int values[MENU_ROW_COUNT] = {
+        [MENU_ROW_COLOR] = ui->bird_color,
+        [MENU_ROW_SCENE] = bg_get_time_mode(),
+        [MENU_ROW_HIRES] = gfx_get_res_mode(),
+        [MENU_ROW_WIDE] = gfx_get_widescreen() ? 1 : 0,
+        [MENU_ROW_PACE] = ui_menu_pace_value(),
+        [MENU_ROW_FPS] = fps_get_visible() ? 1 : 0,
+    };
+    for (int i = 0; i < MENU_ROW_COUNT; i++)
+    {
+        const bool focused = (i == ui->menu_row);
+        const text_parms_t parms = {
+            .style_id = focused ? UI_STYLE_TEXT : UI_STYLE_DIM,
+            .shadow_style_id = UI_STYLE_SHADOW,
+        };
+        text_t *const text = &ui->menu_texts[i];
+        /* Skip the formatting too, not just the layout */
+        if (values[i] == ui->menu_values[i] &&
+            text->font_id == font_id &&
+            text->parms.style_id == parms.style_id)
+        {
+            continue;
+        }
+        ui->menu_values[i] = values[i];
+        char line[TEXT_MAX_LENGTH];
+        ui_menu_format_row(line, sizeof(line), i, focused, values[i]);
+        text_set(text, font_id, &parms, line);
+    }
+}
 
 void ui_menu_tick(ui_t *ui, bird_t *bird, const joypad_buttons_t *buttons)
 {
@@ -751,8 +952,23 @@ void ui_menu_tick(ui_t *ui, bird_t *bird, const joypad_buttons_t *buttons)
             break;
         }
         case MENU_ROW_HIRES:
-            gfx_set_highres(!gfx_get_highres());
+        {
+            gfx_res_mode_t mode = gfx_get_res_mode();
+            mode = (mode + dir + GFX_RES_MODES_COUNT) % GFX_RES_MODES_COUNT;
+            gfx_set_res_mode(mode);
+            break;
+        }
+        case MENU_ROW_WIDE:
+            gfx_set_widescreen(!gfx_get_widescreen());
             break;
+        case MENU_ROW_PACE:
+        {
+            int value = ui_menu_pace_value();
+            value = (value + dir + MENU_PACE_COUNT) % MENU_PACE_COUNT;
+            pace_set_rate(value / MENU_PACE_BUFFER_CHOICES);
+            gfx_set_buffers(GFX_BUFFERS_MAX - value % MENU_PACE_BUFFER_CHOICES);
+            break;
+        }
         case MENU_ROW_FPS:
             fps_set_visible(!fps_get_visible());
             break;
@@ -762,42 +978,15 @@ void ui_menu_tick(ui_t *ui, bird_t *bird, const joypad_buttons_t *buttons)
 
 static void ui_menu_draw(const ui_t *ui)
 {
-    const int font_id = gfx->highres ? FONT_AT01_2X : FONT_AT01;
-    const int line_h = GFX_SCALE(16);
-    const int shadow_offset = GFX_SCALE(1);
-
-    const int start_y = gfx->height / 2 + GFX_SCALE(5);
-
-    /* Get current values */
-    const char *color_str = MENU_COLOR_NAMES[ui->bird_color];
-    const char *scene_str = MENU_SCENE_NAMES[bg_get_time_mode()];
-    const char *hires_str = MENU_BOOL_NAMES[gfx_get_highres() ? 1 : 0];
-    const char *fps_str = MENU_BOOL_NAMES[fps_get_visible() ? 1 : 0];
+    const int line_h = GFX_SCALE_Y(16);
+    const int shadow_offset = GFX_SCALE_Y(1);
 
-    /* Menu row strings */
-    char rows[MENU_ROW_COUNT][32];
-    snprintf(rows[MENU_ROW_COLOR], sizeof(rows[0]), "Color: %s", color_str);
-    snprintf(rows[MENU_ROW_SCENE], sizeof(rows[0]), "Scene: %s", scene_str);
-    snprintf(rows[MENU_ROW_HIRES], sizeof(rows[0]), "Hi-Res: %s", hires_str);
-    snprintf(rows[MENU_ROW_FPS], sizeof(rows[0]), "Show FPS: %s", fps_str);
-
-    rdpq_textparms_t shadow_parms = { .style_id = UI_STYLE_SHADOW };
-    rdpq_textparms_t text_parms = { .style_id = UI_STYLE_TEXT };
-    rdpq_textparms_t dim_parms = { .style_id = UI_STYLE_DIM };
+    const int x = GFX_SCALE_X(32);
+    const int start_y = gfx->height / 2 + GFX_SCALE_Y(5);
 
     for (int i = 0; i < MENU_ROW_COUNT; i++)
     {
-        const bool focused = (i == ui->menu_row);
-        const char *prefix = focused ? "> " : "  ";
-        char line[40];
-        snprintf(line, sizeof(line), "%s%s", prefix, rows[i]);
-
-        const int x = GFX_SCALE(32);
-        const int y = start_y + (i * line_h);
-
-        /* Draw shadow then text (dim if not focused) */
-        rdpq_text_print(&shadow_parms, font_id, x + shadow_offset, y + shadow_offset, line);
-        rdpq_text_print(focused ? &text_parms : &dim_parms, font_id, x, y, line);
+        text_draw(&ui->menu_texts[i], x, start_y + (i * line_h), shadow_offset);
     }
 }
 
@@ -811,12 +1000,19 @@ void ui_draw(const ui_t *ui)
     switch (ui->state)
     {
     case BIRD_STATE_TITLE:
-        ui_logo_draw(ui);
+        if (panel_is_valid(&ui->title_panel))
+        {
+            panel_draw(&ui->title_panel);
+        }
+        else
+        {
+            ui_logo_draw(ui, 0, 0);
+        }
         ui_menu_draw(ui);
         break;
     case BIRD_STATE_READY:
         ui_score_draw(ui);
-        ui_heading_draw(ui, UI_HEADING_GET_READY);
+        ui_heading_draw(ui, UI_HEADING_GET_READY, 0, 0);
         ui_howto_draw(ui);
         break;
     case BIRD_STATE_PLAY:
@@ -824,21 +1020,27 @@ void ui_draw(const ui_t *ui)
         ui_score_draw(ui);
         break;
     case BIRD_STATE_DEAD:
+        if (panel_is_valid(&ui->gameover_panel))
+        {
+            panel_draw(&ui->gameover_panel);
+            ui_sparkle_draw(ui);
+            break;
+        }
         if (ui->heading_draw)
         {
-            ui_heading_draw(ui, UI_HEADING_GAME_OVER);
+            ui_heading_draw(ui, UI_HEADING_GAME_OVER, 0, 0);
         }
         if (ui->board_draw)
         {
-            ui_scoreboard_draw(ui);
+            ui_scoreboard_draw(ui, 0, 0);
         }
         if (ui->score_draw)
         {
-            ui_highscores_draw(ui);
+            ui_highscores_draw(ui, 0, 0);
         }
         if (ui->medal_draw)
         {
-            ui_medal_draw(ui);
+            ui_medal_draw(ui, 0, 0, true);
         }
         break;
     }
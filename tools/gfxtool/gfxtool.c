@@ -0,0 +1,841 @@
+/**
+ * FlappyBird-N64 - gfxtool.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ *
+ * Host-side graphics pipeline helper used by convert_gfx.bash.
+ *
+ * Commands:
+ *   atlas  Pack several PNGs into one atlas PNG and emit a C header
+ *          describing the sub-rectangle of each packed sprite on each page;
+ *          fails if a page would not fit TMEM in the atlas's format.
+ *   format Pick the smallest lossless texture format for a PNG (or check a
+ *          requested one) and report its RDRAM footprint against RGBA16.
+ *   variants
+ *          Split a PNG holding a grid of color variants of one sprite into a
+ *          single palette-index image plus a TLUT with one row per variant.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <strings.h>
+#include <stdarg.h>
+
+#include "lodepng.h"
+
+/* Common definitions */
+
+#define GFXTOOL_MAX_INPUTS      32
+#define GFXTOOL_MAX_NAME        64
+
+/* TMEM is 4KiB; the upper half holds the TLUT whenever a palette is loaded */
+#define TMEM_BYTES              4096
+#define TMEM_BYTES_WITH_TLUT    (TMEM_BYTES / 2)
+
+typedef struct image_s
+{
+    char name[GFXTOOL_MAX_NAME];
+    const char *path;
+    unsigned width;
+    unsigned height;
+    uint8_t *rgba;
+} image_t;
+
+static void die(const char *fmt, const char *arg)
+{
+    fprintf(stderr, "gfxtool: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+/* Like die, for messages that need more than one argument */
+static void die_fmt(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "gfxtool: ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(1);
+}
+
+static void image_load(image_t *image, const char *path)
+{
+    unsigned error = lodepng_decode32_file(&image->rgba, &image->width, &image->height, path);
+    if (error) die("cannot load PNG: %s", path);
+    image->path = path;
+}
+
+static void image_free(image_t *image)
+{
+    free(image->rgba);
+    image->rgba = NULL;
+}
+
+/* Derive a sprite name from a PNG path: "resources/gfx/new.png" -> "new" */
+static void path_to_name(char *name, const char *path)
+{
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    size_t len = strlen(base);
+    if (len > 4 && strcmp(base + len - 4, ".png") == 0) len -= 4;
+    if (len >= GFXTOOL_MAX_NAME) die("name too long: %s", path);
+    memcpy(name, base, len);
+    name[len] = '\0';
+}
+
+static unsigned align_up(unsigned v, unsigned align)
+{
+    return (v + align - 1) & ~(align - 1);
+}
+
+/* Convert a sprite name into a C identifier: "medal-bronze" -> "medal_bronze" */
+static void name_to_ident(char *ident, const char *name, bool upper)
+{
+    for (; *name; name++)
+    {
+        const int c = (unsigned char)*name;
+        *ident++ = !isalnum(c) ? '_' : upper ? toupper(c) : tolower(c);
+    }
+    *ident = '\0';
+}
+
+/* Texture format selection */
+
+typedef enum
+{
+    TEX_FMT_RGBA16,
+    TEX_FMT_RGBA32,
+    TEX_FMT_CI4,
+    TEX_FMT_CI8,
+    TEX_FMT_IA4,
+    TEX_FMT_IA8,
+    TEX_FMT_IA16,
+    TEX_FMT_I4,
+    TEX_FMT_I8,
+    TEX_FMT_COUNT // Not a format; just a count
+} tex_fmt_t;
+
+/* Names match the mksprite `--format` argument */
+static const char *const TEX_FMT_NAMES[TEX_FMT_COUNT] = {
+    [TEX_FMT_RGBA16] = "RGBA16",
+    [TEX_FMT_RGBA32] = "RGBA32",
+    [TEX_FMT_CI4] = "CI4",
+    [TEX_FMT_CI8] = "CI8",
+    [TEX_FMT_IA4] = "IA4",
+    [TEX_FMT_IA8] = "IA8",
+    [TEX_FMT_IA16] = "IA16",
+    [TEX_FMT_I4] = "I4",
+    [TEX_FMT_I8] = "I8",
+};
+
+static const unsigned TEX_FMT_BITS[TEX_FMT_COUNT] = {
+    [TEX_FMT_RGBA16] = 16, [TEX_FMT_RGBA32] = 32,
+    [TEX_FMT_CI4] = 4, [TEX_FMT_CI8] = 8,
+    [TEX_FMT_IA4] = 4, [TEX_FMT_IA8] = 8, [TEX_FMT_IA16] = 16,
+    [TEX_FMT_I4] = 4, [TEX_FMT_I8] = 8,
+};
+
+/* Formats tried by auto-selection; ties go to the earlier entry so that
+ * intensity formats win over palettes (no TLUT load). Intensity-only formats
+ * are never picked because their alpha channel is the intensity itself. */
+static const tex_fmt_t TEX_FMT_AUTO_ORDER[] = {
+    TEX_FMT_IA4, TEX_FMT_CI4, TEX_FMT_IA8, TEX_FMT_CI8, TEX_FMT_RGBA16,
+};
+
+#define TEX_MAX_COLORS  256
+
+typedef struct tex_stats_s
+{
+    /* Distinct colors after RGBA5551 quantization (what RGBA16 stores) */
+    unsigned colors;
+    /* Every visible texel has R == G == B */
+    bool gray;
+    /* Gray levels and alpha values survive 3-bit/1-bit (IA4) storage */
+    bool ia4_exact;
+    /* Gray levels and alpha values survive 4-bit/4-bit (IA8) storage */
+    bool ia8_exact;
+} tex_stats_t;
+
+static uint16_t rgba_to_5551(const uint8_t *px)
+{
+    /* Fully transparent texels all collapse into the same color */
+    if (px[3] < 128) return 0;
+    return ((px[0] >> 3) << 11) | ((px[1] >> 3) << 6) | ((px[2] >> 3) << 1) | 1;
+}
+
+static bool bits_exact(uint8_t v, unsigned bits)
+{
+    /* True when v is an exact bit-replicated expansion of a `bits` value */
+    const unsigned q = v >> (8 - bits);
+    unsigned e = 0;
+    for (int shift = 8 - bits; shift > -(int)bits; shift -= bits)
+    {
+        e |= shift >= 0 ? q << shift : q >> -shift;
+    }
+    return (e & 0xFF) == v;
+}
+
+static void tex_analyze(const image_t *image, tex_stats_t *stats)
+{
+    static uint8_t seen[0x10000];
+    memset(seen, 0, sizeof seen);
+    memset(stats, 0, sizeof *stats);
+    stats->gray = stats->ia4_exact = stats->ia8_exact = true;
+
+    const size_t count = (size_t)image->width * image->height;
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t *px = &image->rgba[i * 4];
+        const uint16_t c = rgba_to_5551(px);
+        if (!seen[c])
+        {
+            seen[c] = 1;
+            stats->colors++;
+        }
+        if (px[3] == 0) continue;
+        if (px[0] != px[1] || px[1] != px[2]) stats->gray = false;
+        if (px[3] != 0xFF || !bits_exact(px[0], 3)) stats->ia4_exact = false;
+        if (!bits_exact(px[3], 4) || !bits_exact(px[0], 4)) stats->ia8_exact = false;
+    }
+    stats->ia4_exact &= stats->gray;
+    stats->ia8_exact &= stats->gray;
+}
+
+static bool tex_fmt_lossless(tex_fmt_t fmt, const tex_stats_t *stats)
+{
+    switch (fmt)
+    {
+        case TEX_FMT_RGBA16:
+        case TEX_FMT_RGBA32:
+            return true;
+        case TEX_FMT_CI4:
+            return stats->colors <= 16;
+        case TEX_FMT_CI8:
+            return stats->colors <= TEX_MAX_COLORS;
+        case TEX_FMT_IA4:
+            return stats->ia4_exact;
+        case TEX_FMT_IA8:
+            return stats->ia8_exact;
+        case TEX_FMT_IA16:
+            return stats->gray;
+        default:
+            return false;
+    }
+}
+
+/* Sprite rows and TMEM lines are both 8-byte aligned */
+static unsigned tex_fmt_stride(tex_fmt_t fmt, unsigned width)
+{
+    return align_up((width * TEX_FMT_BITS[fmt] + 7) / 8, 8);
+}
+
+static bool tex_fmt_has_palette(tex_fmt_t fmt)
+{
+    return fmt == TEX_FMT_CI4 || fmt == TEX_FMT_CI8;
+}
+
+/* Bytes the texels and palette occupy in RDRAM */
+static unsigned tex_fmt_bytes(tex_fmt_t fmt, const image_t *image)
+{
+    unsigned bytes = tex_fmt_stride(fmt, image->width) * image->height;
+    if (fmt == TEX_FMT_CI4) bytes += 16 * 2;
+    if (fmt == TEX_FMT_CI8) bytes += TEX_MAX_COLORS * 2;
+    return bytes;
+}
+
+/* Resolve AUTO to the smallest lossless format, or check a requested one */
+static tex_fmt_t tex_pick_format(const image_t *image, const char *requested, tex_stats_t *stats)
+{
+    tex_analyze(image, stats);
+    tex_fmt_t fmt = TEX_FMT_COUNT;
+    if (strcasecmp(requested, "AUTO") == 0)
+    {
+        const size_t candidates = sizeof TEX_FMT_AUTO_ORDER / sizeof TEX_FMT_AUTO_ORDER[0];
+        for (size_t i = 0; i < candidates; i++)
+        {
+            const tex_fmt_t candidate = TEX_FMT_AUTO_ORDER[i];
+            if (!tex_fmt_lossless(candidate, stats)) continue;
+            /* Palettes are not free: tiny CI8 sprites can outweigh RGBA16 */
+            if (fmt == TEX_FMT_COUNT ||
+                tex_fmt_bytes(candidate, image) < tex_fmt_bytes(fmt, image))
+            {
+                fmt = candidate;
+            }
+        }
+        return fmt;
+    }
+    for (int i = 0; i < TEX_FMT_COUNT && fmt == TEX_FMT_COUNT; i++)
+    {
+        if (strcasecmp(requested, TEX_FMT_NAMES[i]) == 0) fmt = i;
+    }
+    if (fmt == TEX_FMT_COUNT) die("unknown texture format: %s", requested);
+    if (!tex_fmt_lossless(fmt, stats))
+    {
+        fprintf(stderr, "gfxtool: WARNING: %s is lossy for %s (%u colors%s)\n",
+                TEX_FMT_NAMES[fmt], image->path, stats->colors, stats->gray ? ", gray" : "");
+    }
+    return fmt;
+}
+
+static int cmd_format(int argc, char **argv)
+{
+    if (argc < 1 || argc > 2)
+    {
+        fprintf(stderr, "usage: gfxtool format <png> [AUTO|RGBA16|CI4|CI8|IA4|IA8|...]\n");
+        return 1;
+    }
+    const char *requested = argc > 1 ? argv[1] : "AUTO";
+
+    image_t image;
+    image_load(&image, argv[0]);
+    path_to_name(image.name, argv[0]);
+    tex_stats_t stats;
+    const tex_fmt_t fmt = tex_pick_format(&image, requested, &stats);
+
+    /* Machine-readable line consumed by convert_gfx.bash:
+     * <format> <width> <height> <colors> <bytes> <rgba16 bytes> */
+    printf("%s %u %u %u %u %u\n", TEX_FMT_NAMES[fmt], image.width, image.height,
+           stats.colors, tex_fmt_bytes(fmt, &image), tex_fmt_bytes(TEX_FMT_RGBA16, &image));
+    image_free(&image);
+    return 0;
+}
+
+/* Atlas packing */
+
+/* Sub-rectangles start on 8-texel boundaries so 4bpp formats load cleanly */
+#define ATLAS_ALIGN_X       8
+#define ATLAS_PAD_Y         1
+#define ATLAS_MAX_WIDTH     256
+#define ATLAS_MAX_PAGES     16
+
+/*
+ * An atlas is one sprite made of pages stacked top to bottom. Each page is
+ * uploaded to TMEM in one go, so everything drawn together belongs on one
+ * page; a sprite can be placed on several pages to share them.
+ */
+typedef struct atlas_member_s
+{
+    image_t image;
+    int hslices;
+    int vslices;
+    unsigned pages;     // Bit mask of the pages it is placed on
+    unsigned x[ATLAS_MAX_PAGES];
+    unsigned y[ATLAS_MAX_PAGES];
+} atlas_member_t;
+
+typedef struct atlas_page_s
+{
+    char name[GFXTOOL_MAX_NAME];    // Empty when the atlas is a single page
+    unsigned y;
+    unsigned height;
+} atlas_page_t;
+
+typedef struct atlas_shelf_s
+{
+    unsigned y;
+    unsigned height;
+    unsigned used_w;
+} atlas_shelf_t;
+
+static int atlas_page_find(atlas_page_t *pages, int *pages_count, const char *name)
+{
+    for (int p = 0; p < *pages_count; p++)
+    {
+        if (strcmp(pages[p].name, name) == 0) return p;
+    }
+    if (*pages_count >= ATLAS_MAX_PAGES) die("too many atlas pages at %s", name);
+    if (strlen(name) >= GFXTOOL_MAX_NAME) die("page name too long: %s", name);
+    atlas_page_t *const page = &pages[(*pages_count)++];
+    memset(page, 0, sizeof *page);
+    strcpy(page->name, name);
+    return *pages_count - 1;
+}
+
+/* Simple first-fit shelf packer for one page; taller sprites are placed first */
+static unsigned atlas_pack(atlas_member_t *members, int count, int page, unsigned width)
+{
+    int order[GFXTOOL_MAX_INPUTS];
+    int placed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (members[i].pages & (1u << page)) order[placed++] = i;
+    }
+    /* Stable insertion sort by descending height */
+    for (int i = 1; i < placed; i++)
+    {
+        int j = i, o = order[i];
+        while (j > 0 && members[order[j - 1]].image.height < members[o].image.height)
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = o;
+    }
+
+    atlas_shelf_t shelves[GFXTOOL_MAX_INPUTS];
+    int num_shelves = 0;
+    unsigned height = 0;
+    for (int i = 0; i < placed; i++)
+    {
+        atlas_member_t *m = &members[order[i]];
+        if (m->image.width > width) die("sprite is wider than the atlas: %s", m->image.path);
+        atlas_shelf_t *shelf = NULL;
+        for (int s = 0; s < num_shelves && !shelf; s++)
+        {
+            unsigned x = align_up(shelves[s].used_w, ATLAS_ALIGN_X);
+            if (m->image.height <= shelves[s].height && x + m->image.width <= width)
+            {
+                shelf = &shelves[s];
+            }
+        }
+        if (!shelf)
+        {
+            shelf = &shelves[num_shelves++];
+            shelf->y = num_shelves > 1 ? height + ATLAS_PAD_Y : 0;
+            shelf->height = m->image.height;
+            shelf->used_w = 0;
+            height = shelf->y + shelf->height;
+        }
+        m->x[page] = align_up(shelf->used_w, ATLAS_ALIGN_X);
+        m->y[page] = shelf->y;
+        shelf->used_w = m->x[page] + m->image.width;
+    }
+    return height;
+}
+
+/* Pages load one at a time, so the narrowest width with the least area wins */
+static unsigned atlas_pick_width(atlas_member_t *members, int count, int pages_count)
+{
+    unsigned min_width = ATLAS_ALIGN_X;
+    for (int i = 0; i < count; i++)
+    {
+        const unsigned width = align_up(members[i].image.width, ATLAS_ALIGN_X);
+        if (width > min_width) min_width = width;
+    }
+    unsigned best_width = min_width;
+    unsigned best_area = ~0u;
+    for (unsigned width = min_width; width <= ATLAS_MAX_WIDTH; width += ATLAS_ALIGN_X)
+    {
+        unsigned area = 0;
+        for (int p = 0; p < pages_count; p++)
+        {
+            area += width * atlas_pack(members, count, p, width);
+        }
+        if (area < best_area)
+        {
+            best_area = area;
+            best_width = width;
+        }
+    }
+    return best_width;
+}
+
+/* Page index as the header names it; an unnamed single page is just 0 */
+static void atlas_write_page_ident(FILE *f, const char *prefix, const atlas_page_t *page)
+{
+    char ident[GFXTOOL_MAX_NAME];
+    if (page->name[0] == '\0')
+    {
+        fprintf(f, "0");
+        return;
+    }
+    name_to_ident(ident, page->name, true);
+    fprintf(f, "%s_PAGE_%s", prefix, ident);
+}
+
+static void atlas_write_header(const char *path, const char *atlas_name,
+                               const atlas_member_t *members, int count,
+                               const atlas_page_t *pages, int pages_count,
+                               unsigned width, unsigned height)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) die("cannot write header: %s", path);
+
+    char prefix[GFXTOOL_MAX_NAME], type[GFXTOOL_MAX_NAME], ident[GFXTOOL_MAX_NAME];
+    name_to_ident(prefix, atlas_name, true);
+    name_to_ident(type, atlas_name, false);
+    const bool named_pages = pages[0].name[0] != '\0';
+
+    fprintf(f, "/**\n");
+    fprintf(f, " * FlappyBird-N64 - %s.h\n", atlas_name);
+    fprintf(f, " *\n");
+    fprintf(f, " * Generated by gfxtool from resources/gfx/manifest.txt; do not edit.\n");
+    fprintf(f, " */\n\n");
+    fprintf(f, "#ifndef __FLAPPY_%s_H\n", prefix);
+    fprintf(f, "#define __FLAPPY_%s_H\n\n", prefix);
+    fprintf(f, "#include \"atlas.h\"\n\n");
+    fprintf(f, "#define %s_NAME \"%s\"\n", prefix, atlas_name);
+    fprintf(f, "#define %s_WIDTH %u\n", prefix, width);
+    fprintf(f, "#define %s_HEIGHT %u\n\n", prefix, height);
+
+    if (named_pages)
+    {
+        fprintf(f, "typedef enum\n{\n");
+        for (int p = 0; p < pages_count; p++)
+        {
+            fprintf(f, "    ");
+            atlas_write_page_ident(f, prefix, &pages[p]);
+            fprintf(f, ",\n");
+        }
+        fprintf(f, "    %s_PAGES_COUNT // Not a page; just a count\n", prefix);
+        fprintf(f, "} %s_page_t;\n\n", type);
+    }
+    else
+    {
+        fprintf(f, "#define %s_PAGES_COUNT 1\n\n", prefix);
+    }
+
+    fprintf(f, "typedef enum\n{\n");
+    for (int i = 0; i < count; i++)
+    {
+        name_to_ident(ident, members[i].image.name, true);
+        fprintf(f, "    %s_%s,\n", prefix, ident);
+    }
+    fprintf(f, "    %s_RECTS_COUNT // Not a rect; just a count\n", prefix);
+    fprintf(f, "} %s_rect_t;\n\n", type);
+
+    fprintf(f, "static const atlas_page_t %s_PAGES[%s_PAGES_COUNT] = {\n", prefix, prefix);
+    for (int p = 0; p < pages_count; p++)
+    {
+        fprintf(f, "    [");
+        atlas_write_page_ident(f, prefix, &pages[p]);
+        fprintf(f, "] = { %u, %u },\n", pages[p].y, pages[p].height);
+    }
+    fprintf(f, "};\n\n");
+
+    /* Sprites that are not on a page have an empty rect there */
+    fprintf(f, "static const atlas_rect_t %s_RECTS[%s_PAGES_COUNT][%s_RECTS_COUNT] = {\n",
+            prefix, prefix, prefix);
+    for (int p = 0; p < pages_count; p++)
+    {
+        fprintf(f, "    [");
+        atlas_write_page_ident(f, prefix, &pages[p]);
+        fprintf(f, "] = {\n");
+        for (int i = 0; i < count; i++)
+        {
+            const atlas_member_t *m = &members[i];
+            if (!(m->pages & (1u << p))) continue;
+            name_to_ident(ident, m->image.name, true);
+            fprintf(f, "        [%s_%s] = { %u, %u, %u, %u, %d, %d },\n", prefix, ident,
+                    m->x[p], m->y[p], m->image.width, m->image.height, m->hslices, m->vslices);
+        }
+        fprintf(f, "    },\n");
+    }
+    fprintf(f, "};\n\n");
+    fprintf(f, "#endif\n");
+    fclose(f);
+}
+
+static int cmd_atlas(int argc, char **argv)
+{
+    unsigned width = 0;
+    const char *requested = "AUTO";
+    int argi = 0;
+    while (argi < argc && argv[argi][0] == '-')
+    {
+        if (strcmp(argv[argi], "-w") == 0 && argi + 1 < argc)
+        {
+            width = strtoul(argv[argi + 1], NULL, 0);
+            argi += 2;
+        }
+        else if (strcmp(argv[argi], "-f") == 0 && argi + 1 < argc)
+        {
+            requested = argv[argi + 1];
+            argi += 2;
+        }
+        else die("unknown atlas option: %s", argv[argi]);
+    }
+    if (argc - argi < 3)
+    {
+        fprintf(stderr, "usage: gfxtool atlas [-w width] [-f format] <out.png> <out.h> "
+                        "<png>:<hslices>:<vslices>[:<page>,...]...\n");
+        return 1;
+    }
+    const char *out_png = argv[argi++];
+    const char *out_h = argv[argi++];
+    char atlas_name[GFXTOOL_MAX_NAME];
+    path_to_name(atlas_name, out_png);
+
+    atlas_member_t members[GFXTOOL_MAX_INPUTS];
+    atlas_page_t pages[ATLAS_MAX_PAGES];
+    int count = 0;
+    int pages_count = 0;
+    for (; argi < argc; argi++)
+    {
+        if (count >= GFXTOOL_MAX_INPUTS) die("too many atlas inputs at %s", argv[argi]);
+        atlas_member_t *m = &members[count++];
+        memset(m, 0, sizeof *m);
+        /* Split "<png>:<hslices>:<vslices>[:<page>,...]" */
+        char *spec = argv[argi];
+        char *sep = strchr(spec, ':');
+        m->hslices = m->vslices = 1;
+        if (sep)
+        {
+            *sep = '\0';
+            if (sscanf(sep + 1, "%d:%d", &m->hslices, &m->vslices) != 2)
+                die("bad slice spec for %s", spec);
+            char *page_list = strchr(sep + 1, ':');
+            page_list = page_list ? strchr(page_list + 1, ':') : NULL;
+            for (char *page = page_list ? strtok(page_list + 1, ",") : NULL; page; page = strtok(NULL, ","))
+            {
+                m->pages |= 1u << atlas_page_find(pages, &pages_count, page);
+            }
+        }
+        image_load(&m->image, spec);
+        path_to_name(m->image.name, spec);
+    }
+
+    /* Without named pages the whole atlas is one page */
+    if (pages_count == 0)
+    {
+        atlas_page_find(pages, &pages_count, "");
+        for (int i = 0; i < count; i++) members[i].pages = 1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (!members[i].pages) die("sprite is on no page of its atlas: %s", members[i].image.path);
+    }
+
+    if (!width) width = atlas_pick_width(members, count, pages_count);
+    unsigned height = 0;
+    for (int p = 0; p < pages_count; p++)
+    {
+        pages[p].y = height;
+        pages[p].height = atlas_pack(members, count, p, width);
+        height += pages[p].height;
+        for (int i = 0; i < count; i++) members[i].y[p] += pages[p].y;
+    }
+
+    /* Blit every member onto its pages; unused texels are transparent */
+    image_t atlas = { .path = out_png, .width = width, .height = height };
+    atlas.rgba = calloc((size_t)width * height, 4);
+    for (int i = 0; i < count; i++)
+    {
+        const atlas_member_t *m = &members[i];
+        for (int p = 0; p < pages_count; p++)
+        {
+            if (!(m->pages & (1u << p))) continue;
+            for (unsigned y = 0; y < m->image.height; y++)
+            {
+                memcpy(&atlas.rgba[((m->y[p] + y) * width + m->x[p]) * 4],
+                       &m->image.rgba[y * m->image.width * 4],
+                       m->image.width * 4);
+            }
+        }
+    }
+    unsigned error = lodepng_encode32_file(out_png, atlas.rgba, width, height);
+    if (error) die("cannot write PNG: %s", out_png);
+
+    /* Every page has to fit TMEM alongside its palette, if it has one */
+    tex_stats_t stats;
+    const tex_fmt_t fmt = tex_pick_format(&atlas, requested, &stats);
+    const unsigned tmem_bytes = tex_fmt_has_palette(fmt) ? TMEM_BYTES_WITH_TLUT : TMEM_BYTES;
+    printf("%s: %ux%u %s, %d sprites, %d page(s)\n",
+           atlas_name, width, height, TEX_FMT_NAMES[fmt], count, pages_count);
+    for (int p = 0; p < pages_count; p++)
+    {
+        const unsigned page_bytes = tex_fmt_stride(fmt, width) * pages[p].height;
+        printf("  page %-14s %3u rows, %4u of %u TMEM bytes\n",
+               pages[p].name[0] ? pages[p].name : "-", pages[p].height, page_bytes, tmem_bytes);
+        if (page_bytes > tmem_bytes)
+        {
+            remove(out_png);
+            die_fmt("%s page %s needs %u bytes of TMEM as %s; only %u are free",
+                    atlas_name, pages[p].name[0] ? pages[p].name : "-", page_bytes,
+                    TEX_FMT_NAMES[fmt], tmem_bytes);
+        }
+    }
+    free(atlas.rgba);
+
+    atlas_write_header(out_h, atlas_name, members, count, pages, pages_count, width, height);
+    for (int i = 0; i < count; i++)
+    {
+        printf("  %-16s %3ux%-3u\n", members[i].image.name,
+               members[i].image.width, members[i].image.height);
+        image_free(&members[i].image);
+    }
+    return 0;
+}
+
+/* Palette variants */
+
+#define TLUT_MAGIC          "TLUT"
+#define TLUT_HEADER_BYTES   16
+#define TLUT_MAX_VARIANTS   16
+
+static void write_be16(FILE *f, uint16_t v)
+{
+    fputc(v >> 8, f);
+    fputc(v & 0xFF, f);
+}
+
+/*
+ * TLUT file layout (big-endian), matching src/palette.c:
+ *   char     magic[4]  "TLUT"
+ *   uint16_t variants  number of palette rows
+ *   uint16_t colors    used entries per row
+ *   uint16_t base      first TLUT entry the rows are loaded at
+ *   uint16_t stride    entries per row, padded so rows stay 8-byte aligned
+ *   uint32_t reserved
+ *   uint16_t entries[variants][stride]  RGBA5551
+ */
+static unsigned tlut_write(const char *path, const uint16_t *tuples, unsigned colors,
+                           unsigned variants, unsigned base)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) die("cannot write TLUT: %s", path);
+    const unsigned stride = align_up(colors, 4);
+    fwrite(TLUT_MAGIC, 1, 4, f);
+    write_be16(f, variants);
+    write_be16(f, colors);
+    write_be16(f, base);
+    write_be16(f, stride);
+    write_be16(f, 0);
+    write_be16(f, 0);
+    for (unsigned v = 0; v < variants; v++)
+    {
+        for (unsigned c = 0; c < stride; c++)
+        {
+            write_be16(f, c < colors ? tuples[c * variants + v] : 0);
+        }
+    }
+    fclose(f);
+    return TLUT_HEADER_BYTES + variants * stride * 2;
+}
+
+static int cmd_variants(int argc, char **argv)
+{
+    unsigned cols = 1, rows = 1, base = 0;
+    int argi = 0;
+    while (argi < argc && argv[argi][0] == '-')
+    {
+        if (strcmp(argv[argi], "-g") == 0 && argi + 1 < argc)
+        {
+            if (sscanf(argv[argi + 1], "%ux%u", &cols, &rows) != 2)
+                die("bad variant grid: %s", argv[argi + 1]);
+            argi += 2;
+        }
+        else if (strcmp(argv[argi], "-b") == 0 && argi + 1 < argc)
+        {
+            base = strtoul(argv[argi + 1], NULL, 0);
+            argi += 2;
+        }
+        else die("unknown variants option: %s", argv[argi]);
+    }
+    if (argc - argi != 4)
+    {
+        fprintf(stderr, "usage: gfxtool variants [-g <cols>x<rows>] [-b tlut_base] "
+                        "<in.png> <AUTO|CI4|CI8> <out.png> <out.tlut>\n");
+        return 1;
+    }
+    const char *in_png = argv[argi++];
+    const char *requested = argv[argi++];
+    const char *out_png = argv[argi++];
+    const char *out_tlut = argv[argi++];
+
+    image_t image;
+    image_load(&image, in_png);
+    const unsigned variants = cols * rows;
+    if (variants < 1 || variants > TLUT_MAX_VARIANTS) die("bad variant count for %s", in_png);
+    if (image.width % cols || image.height % rows) die("PNG does not divide into the variant grid: %s", in_png);
+    const unsigned width = image.width / cols;
+    const unsigned height = image.height / rows;
+
+    /*
+     * Each distinct tuple of per-variant colors at a texel position becomes
+     * one palette index; variants never have to be functions of each other.
+     * Index 0 is reserved for texels that are transparent in every variant.
+     */
+    uint16_t *tuples = calloc(TEX_MAX_COLORS * variants, sizeof(uint16_t));
+    uint8_t *indices = malloc((size_t)width * height);
+    uint16_t tuple[TLUT_MAX_VARIANTS];
+    unsigned colors = 1;
+    for (unsigned y = 0; y < height; y++)
+    {
+        for (unsigned x = 0; x < width; x++)
+        {
+            for (unsigned v = 0; v < variants; v++)
+            {
+                const unsigned vx = (v % cols) * width + x;
+                const unsigned vy = (v / cols) * height + y;
+                tuple[v] = rgba_to_5551(&image.rgba[(vy * image.width + vx) * 4]);
+            }
+            unsigned idx = 0;
+            while (idx < colors && memcmp(&tuples[idx * variants], tuple, variants * sizeof(uint16_t)))
+            {
+                idx++;
+            }
+            if (idx == colors)
+            {
+                if (colors == TEX_MAX_COLORS) die("too many color combinations in %s", in_png);
+                memcpy(&tuples[colors++ * variants], tuple, variants * sizeof(uint16_t));
+            }
+            indices[y * width + x] = idx;
+        }
+    }
+
+    /* CI4 rows live in one 16-entry TLUT bank; CI8 can start anywhere */
+    const bool ci4_fits = colors <= 16 && base % 16 == 0;
+    tex_fmt_t fmt;
+    if (strcasecmp(requested, "AUTO") == 0) fmt = ci4_fits ? TEX_FMT_CI4 : TEX_FMT_CI8;
+    else if (strcasecmp(requested, "CI4") == 0) fmt = TEX_FMT_CI4;
+    else if (strcasecmp(requested, "CI8") == 0) fmt = TEX_FMT_CI8;
+    else die("variants need a palettized format, not %s", requested);
+    if (fmt == TEX_FMT_CI4 && !ci4_fits) die("palette does not fit a CI4 bank: %s", in_png);
+    if (base + colors > TEX_MAX_COLORS) die("palette overflows the TLUT: %s", in_png);
+
+    /*
+     * mksprite has no way to keep our indices in a CI texture, so the index
+     * image is written as grayscale for an I4/I8 conversion; the game binds
+     * those texels as CI4/CI8 and loads the TLUT itself. CI8 indices already
+     * include the base; CI4 indices are relative to the bank.
+     */
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        indices[i] = fmt == TEX_FMT_CI4 ? indices[i] * 17 : indices[i] + base;
+    }
+    unsigned error = lodepng_encode_file(out_png, indices, width, height, LCT_GREY, 8);
+    if (error) die("cannot write PNG: %s", out_png);
+    const unsigned tlut_bytes = tlut_write(out_tlut, tuples, colors, variants, base);
+
+    /* Same machine-readable line as `format`, comparing against the RGBA16
+     * source that stored every variant as its own copy */
+    const image_t index_image = { .width = width, .height = height };
+    printf("%s %u %u %u %u %u\n", TEX_FMT_NAMES[fmt], width, height, colors,
+           tex_fmt_bytes(fmt == TEX_FMT_CI4 ? TEX_FMT_I4 : TEX_FMT_I8, &index_image) + tlut_bytes,
+           tex_fmt_bytes(TEX_FMT_RGBA16, &image));
+    free(indices);
+    free(tuples);
+    image_free(&image);
+    return 0;
+}
+
+/* Entry point */
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: gfxtool <command> [args...]\n");
+        fprintf(stderr, "commands:\n");
+        fprintf(stderr, "  atlas   Pack PNGs into an atlas PNG and C header\n");
+        fprintf(stderr, "  format  Choose or check the texture format of a PNG\n");
+        fprintf(stderr, "  variants  Store color variants as one index image plus a TLUT\n");
+        return 1;
+    }
+    if (strcmp(argv[1], "atlas") == 0) return cmd_atlas(argc - 2, argv + 2);
+    if (strcmp(argv[1], "format") == 0) return cmd_format(argc - 2, argv + 2);
+    if (strcmp(argv[1], "variants") == 0) return cmd_variants(argc - 2, argv + 2);
+    die("unknown command: %s", argv[1]);
+    return 1;
+}
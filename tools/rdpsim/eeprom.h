@@ -0,0 +1,43 @@
+/**
+ * FlappyBird-N64 - eeprom.h (rdpsim)
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ *
+ * rdpsim has no save chip, so the high score always starts at zero.
+ */
+
+#ifndef __RDPSIM_EEPROM_H
+#define __RDPSIM_EEPROM_H
+
+#include <stdint.h>
+
+#define EEPROM_BLOCK_SIZE 8
+
+typedef enum
+{
+    EEPROM_NONE,
+    EEPROM_4K,
+    EEPROM_16K,
+} eeprom_type_t;
+
+static inline eeprom_type_t eeprom_present(void)
+{
+    return EEPROM_NONE;
+}
+
+static inline void eeprom_read(int block, uint8_t *dest)
+{
+    (void)block;
+    (void)dest;
+}
+
+static inline void eeprom_write(int block, const uint8_t *src)
+{
+    (void)block;
+    (void)src;
+}
+
+#endif
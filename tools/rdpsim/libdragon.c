@@ -0,0 +1,383 @@
+/**
+ * FlappyBird-N64 - libdragon.c (rdpsim)
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ *
+ * Everything in the libdragon stand-in except the RDP: a clock that only
+ * moves when told to, one display buffer, and assets read from the build
+ * tree. Sprites are decoded from the PNGs mksprite would have converted,
+ * using the manifest to find their slicing and index formats.
+ */
+
+#include <stdarg.h>
+
+#include "lodepng.h"
+
+#include "rdpsim.h"
+
+/* Host definitions */
+
+#define HOST_PATH_MAX       512
+#define HOST_ROM_PREFIX     "rom:/"
+#define HOST_MANIFEST_NAME  "manifest.txt"
+#define HOST_VI_REGS_COUNT  16
+#define HOST_VI_HANDLERS_MAX 8
+
+/* The game is simulated from one second after boot, like a real power-on */
+#define HOST_START_TICKS    ((uint64_t)TICKS_PER_SECOND)
+
+const resolution_t RESOLUTION_320x240 = { 320, 240, INTERLACE_OFF, 4.0f / 3.0f };
+const resolution_t RESOLUTION_640x480 = { 640, 480, INTERLACE_HALF, 4.0f / 3.0f };
+
+static struct host_s
+{
+    bool verbose;
+    uint64_t ticks;
+    surface_t display;
+    void (*vi_handlers[HOST_VI_HANDLERS_MAX])(void);
+    int vi_handlers_count;
+    const char *png_dir;
+    const char *gen_dir;
+    const char *rom_dir;
+} host = {
+    .ticks = HOST_START_TICKS,
+    .png_dir = "resources/gfx",
+    .gen_dir = "build/gen",
+    .rom_dir = "build/dfs",
+};
+
+/* Setup */
+
+void rdpsim_set_verbose(bool verbose)
+{
+    host.verbose = verbose;
+}
+
+void rdpsim_set_dirs(const char *png_dir, const char *gen_dir, const char *rom_dir)
+{
+    host.png_dir = png_dir;
+    host.gen_dir = gen_dir;
+    host.rom_dir = rom_dir;
+}
+
+static void host_die(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "rdpsim: ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(1);
+}
+
+void debugf(const char *fmt, ...)
+{
+    if (!host.verbose) return;
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+/* Timer */
+
+void rdpsim_advance_ticks(uint64_t ticks)
+{
+    host.ticks += ticks;
+}
+
+long long timer_ticks(void)
+{
+    return (long long)host.ticks;
+}
+
+uint64_t get_ticks(void)
+{
+    return host.ticks;
+}
+
+/* Memory and assets */
+
+void *malloc_uncached_aligned(int align, size_t size)
+{
+    (void)align;
+    return calloc(1, size);
+}
+
+void free_uncached(void *buf)
+{
+    free(buf);
+}
+
+static void *host_read_file(const char *path, int *size)
+{
+    FILE *const file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *const data = malloc(length > 0 ? length : 1);
+    if (fread(data, 1, length, file) != (size_t)length)
+    {
+        host_die("cannot read %s", path);
+    }
+    fclose(file);
+    *size = (int)length;
+    return data;
+}
+
+static bool host_is_little_endian(void)
+{
+    const uint16_t probe = 1;
+    return *(const uint8_t *)&probe == 1;
+}
+
+/*
+ * Reads "rom:/..." from the filesystem root the ROM is built from. TLUTs are
+ * big-endian uint16s after their magic, which the game reads in place.
+ */
+void *asset_load(const char *path, int *size)
+{
+    if (strncmp(path, HOST_ROM_PREFIX, strlen(HOST_ROM_PREFIX)) != 0)
+    {
+        host_die("not a ROM path: %s", path);
+    }
+    char host_path[HOST_PATH_MAX];
+    snprintf(host_path, sizeof(host_path), "%s/%s", host.rom_dir, path + strlen(HOST_ROM_PREFIX));
+    uint8_t *const data = host_read_file(host_path, size);
+    if (data == NULL) host_die("cannot open %s (build the ROM's filesystem first)", host_path);
+    const size_t len = strlen(path);
+    if (len > 5 && strcmp(path + len - 5, ".tlut") == 0 && host_is_little_endian())
+    {
+        for (int i = 4; i + 1 < *size; i += 2)
+        {
+            const uint8_t hi = data[i];
+            data[i] = data[i + 1];
+            data[i + 1] = hi;
+        }
+    }
+    return data;
+}
+
+/* Surfaces */
+
+surface_t surface_alloc(tex_format_t format, uint16_t width, uint16_t height)
+{
+    const uint16_t stride = TEX_FORMAT_PIX2BYTES(format, width);
+    return surface_make(calloc(height, stride), format, width, height, stride);
+}
+
+void surface_free(surface_t *surface)
+{
+    free(surface->buffer);
+    *surface = surface_make_zero();
+}
+
+/* Sprites */
+
+typedef struct host_manifest_entry_s
+{
+    int hslices;
+    int vslices;
+    char format[16];
+    bool variants;
+} host_manifest_entry_t;
+
+/* Same lookup as convert_gfx.bash; sprites missing from it are 1x1 AUTO */
+static host_manifest_entry_t host_manifest_find(const char *name)
+{
+    host_manifest_entry_t entry = { .hslices = 1, .vslices = 1, .format = "AUTO" };
+    char path[HOST_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", host.png_dir, HOST_MANIFEST_NAME);
+    FILE *const file = fopen(path, "r");
+    if (file == NULL) host_die("cannot open %s", path);
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+    {
+        char *token = strtok(line, " \t\r\n");
+        if (token == NULL || token[0] == '#' || strcmp(token, name) != 0) continue;
+        if ((token = strtok(NULL, " \t\r\n"))) entry.hslices = atoi(token);
+        if ((token = strtok(NULL, " \t\r\n"))) entry.vslices = atoi(token);
+        if ((token = strtok(NULL, " \t\r\n")))
+        {
+            snprintf(entry.format, sizeof(entry.format), "%s", token);
+        }
+        while ((token = strtok(NULL, " \t\r\n")))
+        {
+            if (strncmp(token, "variants=", 9) == 0) entry.variants = true;
+        }
+        break;
+    }
+    fclose(file);
+    return entry;
+}
+
+/*
+ * Index images are grayscale, as gfxtool wrote them for mksprite: CI4 as
+ * index * 17, CI8 as the TLUT entry. The TLUT header settles which, the same
+ * way gfxtool picked it.
+ */
+static surface_t host_load_index_image(const char *name, const host_manifest_entry_t *entry)
+{
+    char path[HOST_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/gfx/%s.tlut", host.rom_dir, name);
+    int size;
+    uint8_t *const tlut = host_read_file(path, &size);
+    if (tlut == NULL || size < 12) host_die("cannot open %s (build the ROM's filesystem first)", path);
+    const int colors = (tlut[6] << 8) | tlut[7];
+    const int base = (tlut[8] << 8) | tlut[9];
+    free(tlut);
+    bool ci4 = colors <= 16 && base % 16 == 0;
+    if (strcmp(entry->format, "CI4") == 0) ci4 = true;
+    if (strcmp(entry->format, "CI8") == 0) ci4 = false;
+
+    snprintf(path, sizeof(path), "%s/%s.png", host.gen_dir, name);
+    unsigned char *gray;
+    unsigned width, height;
+    if (lodepng_decode_file(&gray, &width, &height, path, LCT_GREY, 8))
+    {
+        host_die("cannot decode %s", path);
+    }
+    surface_t surface = surface_alloc(ci4 ? FMT_I4 : FMT_I8, width, height);
+    for (unsigned y = 0; y < height; y++)
+    {
+        uint8_t *const row = (uint8_t *)surface.buffer + y * surface.stride;
+        for (unsigned x = 0; x < width; x++)
+        {
+            const uint8_t value = gray[y * width + x];
+            if (!ci4)
+            {
+                row[x] = value;
+                continue;
+            }
+            row[x / 2] |= (x & 1) ? value / 17 : (value / 17) << 4;
+        }
+    }
+    free(gray);
+    return surface;
+}
+
+/* Direct-color sprites keep the PNG's colors; atlases only exist as generated PNGs */
+static surface_t host_load_color_image(const char *name)
+{
+    char path[HOST_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s.png", host.png_dir, name);
+    FILE *const probe = fopen(path, "rb");
+    if (probe) fclose(probe);
+    else snprintf(path, sizeof(path), "%s/%s.png", host.gen_dir, name);
+    unsigned char *rgba;
+    unsigned width, height;
+    if (lodepng_decode_file(&rgba, &width, &height, path, LCT_RGBA, 8))
+    {
+        host_die("cannot decode %s", path);
+    }
+    surface_t surface = surface_alloc(FMT_RGBA32, width, height);
+    memcpy(surface.buffer, rgba, (size_t)width * height * 4);
+    free(rgba);
+    return surface;
+}
+
+sprite_t *sprite_load(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    char name[128];
+    snprintf(name, sizeof(name), "%s", slash ? slash + 1 : path);
+    char *const ext = strstr(name, ".sprite");
+    if (ext) *ext = '\0';
+
+    const host_manifest_entry_t entry = host_manifest_find(name);
+    sprite_t *const sprite = calloc(1, sizeof(sprite_t));
+    sprite->pixels = entry.variants ? host_load_index_image(name, &entry) : host_load_color_image(name);
+    sprite->width = sprite->pixels.width;
+    sprite->height = sprite->pixels.height;
+    sprite->hslices = entry.hslices;
+    sprite->vslices = entry.vslices;
+    return sprite;
+}
+
+void sprite_free(sprite_t *sprite)
+{
+    if (sprite == NULL) return;
+    surface_free(&sprite->pixels);
+    free(sprite);
+}
+
+surface_t sprite_get_pixels(sprite_t *sprite)
+{
+    return sprite->pixels;
+}
+
+/* Sprites are read from PNGs here; palettes only come from the .tlut files */
+uint16_t *sprite_get_palette(sprite_t *sprite)
+{
+    (void)sprite;
+    return NULL;
+}
+
+/* Display; one buffer is enough when nothing is ever shown */
+
+void display_init(resolution_t res, bitdepth_t bit, uint32_t num_buffers,
+    gamma_t gamma, filter_options_t filters)
+{
+    (void)bit;
+    (void)num_buffers;
+    (void)gamma;
+    (void)filters;
+    host.display = surface_alloc(FMT_RGBA16, res.width, res.height);
+}
+
+void display_close(void)
+{
+    surface_free(&host.display);
+}
+
+surface_t *display_get(void)
+{
+    return &host.display;
+}
+
+int display_get_width(void)
+{
+    return host.display.width;
+}
+
+int display_get_height(void)
+{
+    return host.display.height;
+}
+
+/* Shown at once: the VI scans the buffer out on the next field */
+void display_show(surface_t *surface)
+{
+    const uint32_t field = (rdpsim_vi_regs[4] ^ 1) & 1;
+    rdpsim_vi_regs[4] = field;
+    rdpsim_vi_regs[1] = PhysicalAddr(surface->buffer) + field * surface->stride;
+    for (int i = 0; i < host.vi_handlers_count; i++)
+    {
+        host.vi_handlers[i]();
+    }
+}
+
+/* Views into the display buffer, such as one field's lines, count too */
+bool rdpsim_is_display(const surface_t *surface)
+{
+    const uint8_t *const start = host.display.buffer;
+    const uint8_t *const end = start + host.display.stride * host.display.height;
+    return surface->buffer != NULL &&
+        (const uint8_t *)surface->buffer >= start && (const uint8_t *)surface->buffer < end;
+}
+
+volatile uint32_t rdpsim_vi_regs[HOST_VI_REGS_COUNT];
+
+/* Called in registration order rather than libdragon's reverse one */
+void register_VI_handler(void (*callback)(void))
+{
+    if (host.vi_handlers_count < HOST_VI_HANDLERS_MAX)
+    {
+        host.vi_handlers[host.vi_handlers_count++] = callback;
+    }
+}
@@ -0,0 +1,388 @@
+/**
+ * FlappyBird-N64 - libdragon.h (rdpsim)
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ *
+ * Host stand-in for the part of libdragon the game's drawing code uses, so
+ * that bg.c, pipes.c, bird.c and ui.c build unchanged for rdpsim. Names and
+ * signatures follow libdragon; anything the game does not call is left out.
+ * The rdpq functions rasterize in software (see rdpq.c); the rest are just
+ * enough to load assets and run the game's ticks on a simulated clock.
+ */
+
+#ifndef __RDPSIM_LIBDRAGON_H
+#define __RDPSIM_LIBDRAGON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/* Debugging */
+
+#define assertf(cond, ...) assert(cond)
+
+void debugf(const char *fmt, ...);
+
+/* Timer; time only moves when rdpsim advances it */
+
+#define TICKS_PER_SECOND    (93750000 / 2)
+#define TICKS_TO_US(t)      ((t) / (TICKS_PER_SECOND / 1000000))
+#define TICKS_FROM_US(us)   ((us) * (TICKS_PER_SECOND / 1000000))
+#define TICKS_READ()        ((uint32_t)timer_ticks())
+
+long long timer_ticks(void);
+
+uint64_t get_ticks(void);
+
+/* Memory */
+
+void *malloc_uncached_aligned(int align, size_t size);
+
+void free_uncached(void *buf);
+
+static inline void data_cache_hit_writeback(const void *addr, unsigned long length)
+{
+    (void)addr;
+    (void)length;
+}
+
+void *asset_load(const char *path, int *size);
+
+/* Colors */
+
+typedef struct
+{
+    uint8_t r, g, b, a;
+} color_t;
+
+#define RGBA32(rx, gx, bx, ax) ((color_t){ .r = (rx), .g = (gx), .b = (bx), .a = (ax) })
+
+static inline uint16_t color_to_packed16(color_t c)
+{
+    return ((c.r >> 3) << 11) | ((c.g >> 3) << 6) | ((c.b >> 3) << 1) | (c.a >> 7);
+}
+
+static inline color_t color_from_packed16(uint16_t c)
+{
+    const int r = (c >> 11) & 0x1F, g = (c >> 6) & 0x1F, b = (c >> 1) & 0x1F;
+    return RGBA32((r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2), (c & 1) ? 0xFF : 0);
+}
+
+/* Surfaces */
+
+typedef enum
+{
+    FMT_NONE,
+    FMT_RGBA16,
+    FMT_RGBA32,
+    FMT_CI4,
+    FMT_CI8,
+    FMT_I4,
+    FMT_I8,
+} tex_format_t;
+
+#define TEX_FORMAT_BITDEPTH(fmt) \
+    ((fmt) == FMT_RGBA32 ? 32 : (fmt) == FMT_RGBA16 ? 16 : \
+     ((fmt) == FMT_CI4 || (fmt) == FMT_I4) ? 4 : 8)
+#define TEX_FORMAT_PIX2BYTES(fmt, pixels) ((TEX_FORMAT_BITDEPTH(fmt) * (pixels) + 7) / 8)
+
+typedef struct surface_s
+{
+    uint16_t flags;  // The format, as in libdragon
+    uint16_t width;
+    uint16_t height;
+    uint16_t stride;
+    void *buffer;
+} surface_t;
+
+static inline surface_t surface_make(void *buffer, tex_format_t format,
+    uint16_t width, uint16_t height, uint16_t stride)
+{
+    return (surface_t){ .flags = format, .width = width, .height = height,
+        .stride = stride, .buffer = buffer };
+}
+
+static inline surface_t surface_make_zero(void)
+{
+    return (surface_t){0};
+}
+
+static inline tex_format_t surface_get_format(const surface_t *surface)
+{
+    return (tex_format_t)surface->flags;
+}
+
+surface_t surface_alloc(tex_format_t format, uint16_t width, uint16_t height);
+
+void surface_free(surface_t *surface);
+
+/* Sprites; rdpsim reads the PNGs the ROM's sprites are converted from */
+
+typedef struct sprite_s
+{
+    uint16_t width;
+    uint16_t height;
+    uint8_t hslices;
+    uint8_t vslices;
+    surface_t pixels;
+} sprite_t;
+
+sprite_t *sprite_load(const char *path);
+
+void sprite_free(sprite_t *sprite);
+
+surface_t sprite_get_pixels(sprite_t *sprite);
+
+uint16_t *sprite_get_palette(sprite_t *sprite);
+
+/* Display */
+
+typedef enum
+{
+    INTERLACE_OFF,
+    INTERLACE_HALF,
+    INTERLACE_FULL,
+} interlace_mode_t;
+
+typedef struct
+{
+    int32_t width;
+    int32_t height;
+    interlace_mode_t interlaced;
+    float aspect_ratio;
+} resolution_t;
+
+extern const resolution_t RESOLUTION_320x240;
+extern const resolution_t RESOLUTION_640x480;
+
+typedef enum { DEPTH_16_BPP, DEPTH_32_BPP } bitdepth_t;
+typedef enum { GAMMA_NONE, GAMMA_CORRECT } gamma_t;
+typedef enum
+{
+    FILTERS_DISABLED,
+    FILTERS_RESAMPLE,
+    FILTERS_DEDITHER,
+    FILTERS_RESAMPLE_ANTIALIAS,
+    FILTERS_RESAMPLE_ANTIALIAS_DEDITHER,
+} filter_options_t;
+
+void display_init(resolution_t res, bitdepth_t bit, uint32_t num_buffers,
+    gamma_t gamma, filter_options_t filters);
+
+void display_close(void);
+
+surface_t *display_get(void);
+
+int display_get_width(void);
+
+int display_get_height(void);
+
+void display_show(surface_t *surface);
+
+/* Interrupts and the VI; a vblank happens whenever a buffer is shown */
+
+extern volatile uint32_t rdpsim_vi_regs[];
+#define GFX_VI_REGS rdpsim_vi_regs
+
+#define PhysicalAddr(addr) ((uint32_t)(uintptr_t)(addr))
+
+void register_VI_handler(void (*callback)(void));
+
+static inline void disable_interrupts(void) {}
+
+static inline void enable_interrupts(void) {}
+
+/* Controllers and save data */
+
+typedef union
+{
+    uint16_t raw;
+    struct
+    {
+        unsigned a : 1, b : 1, z : 1, start : 1;
+        unsigned d_up : 1, d_down : 1, d_left : 1, d_right : 1;
+        unsigned l : 1, r : 1;
+        unsigned c_up : 1, c_down : 1, c_left : 1, c_right : 1;
+    };
+} joypad_buttons_t;
+
+typedef enum { JOYPAD_PORT_1 } joypad_port_t;
+
+static inline void joypad_set_rumble_active(joypad_port_t port, bool active)
+{
+    (void)port;
+    (void)active;
+}
+
+/* rdpq: modes */
+
+typedef enum { TILE0, TILE1, TILE2, TILE3, TILE4, TILE5, TILE6, TILE7 } rdpq_tile_t;
+
+typedef enum { TLUT_NONE, TLUT_RGBA16, TLUT_IA16 } rdpq_tlut_t;
+typedef enum { FILTER_POINT, FILTER_BILINEAR, FILTER_MEDIAN } rdpq_filter_t;
+
+/* Only the combiners and blenders the game uses are told apart */
+typedef uint64_t rdpq_combiner_t;
+typedef uint32_t rdpq_blender_t;
+
+#define RDPQ_COMBINER_TEX       ((rdpq_combiner_t)1)
+#define RDPQ_COMBINER_FLAT      ((rdpq_combiner_t)2)
+#define RDPQ_BLENDER_MULTIPLY   ((rdpq_blender_t)1)
+
+void rdpq_init(void);
+
+void rdpq_set_mode_fill(color_t color);
+
+void rdpq_set_mode_copy(bool transparency);
+
+void rdpq_set_mode_standard(void);
+
+void rdpq_mode_alphacompare(int threshold);
+
+void rdpq_mode_blender(rdpq_blender_t blend);
+
+void rdpq_mode_combiner(rdpq_combiner_t comb);
+
+void rdpq_mode_filter(rdpq_filter_t filter);
+
+void rdpq_mode_tlut(rdpq_tlut_t tlut);
+
+void rdpq_set_prim_color(color_t color);
+
+/* rdpq: render targets */
+
+void rdpq_attach(const surface_t *surf_color, const surface_t *surf_z);
+
+void rdpq_attach_clear(const surface_t *surf_color, const surface_t *surf_z);
+
+void rdpq_detach(void);
+
+void rdpq_detach_wait(void);
+
+void rdpq_detach_cb(void (*cb)(void *), void *arg);
+
+bool rdpq_is_attached(void);
+
+void rdpq_clear(color_t color);
+
+void rdpq_call_deferred(void (*func)(void *), void *arg);
+
+static inline void rspq_wait(void) {}
+
+/* rdpq: textures */
+
+#define REPEAT_INFINITE 2048
+#define MIRROR_NONE     false
+
+typedef struct
+{
+    int tmem_addr;
+    int palette;
+    struct
+    {
+        float translate;
+        int scale_log;
+        float repeats;
+        bool mirror;
+    } s, t;
+} rdpq_texparms_t;
+
+typedef struct
+{
+    rdpq_tile_t tile;
+    int s0, t0;
+    int width, height;
+    bool flip_x, flip_y;
+    int cx, cy;
+    float scale_x, scale_y;
+    float theta;
+    bool filtering;
+} rdpq_blitparms_t;
+
+int rdpq_tex_upload(rdpq_tile_t tile, const surface_t *tex, const rdpq_texparms_t *parms);
+
+int rdpq_tex_upload_sub(rdpq_tile_t tile, const surface_t *tex, const rdpq_texparms_t *parms,
+    int s0, int t0, int s1, int t1);
+
+void rdpq_tex_upload_tlut(uint16_t *tlut, int color_idx, int num_colors);
+
+void rdpq_tex_multi_begin(void);
+
+int rdpq_tex_multi_end(void);
+
+int rdpq_sprite_upload(rdpq_tile_t tile, sprite_t *sprite, const rdpq_texparms_t *parms);
+
+void rdpq_tex_blit(const surface_t *surf, float x0, float y0, const rdpq_blitparms_t *parms);
+
+void rdpq_sprite_blit(sprite_t *sprite, float x0, float y0, const rdpq_blitparms_t *parms);
+
+/* rdpq: primitives */
+
+void rdpq_fill_rectangle(float x0, float y0, float x1, float y1);
+
+void rdpq_texture_rectangle_scaled(rdpq_tile_t tile, float x0, float y0, float x1, float y1,
+    float s0, float t0, float s1, float t1);
+
+/* rdpq: text; glyphs are drawn as solid cells of the font's nominal size */
+
+typedef struct rdpq_font_s rdpq_font_t;
+
+typedef struct
+{
+    color_t color;
+    color_t outline_color;
+} rdpq_fontstyle_t;
+
+typedef enum { ALIGN_LEFT, ALIGN_CENTER, ALIGN_RIGHT } rdpq_align_t;
+
+typedef struct
+{
+    int16_t width;
+    int16_t height;
+    rdpq_align_t align;
+    uint8_t style_id;
+} rdpq_textparms_t;
+
+typedef struct
+{
+    float x0, y0, x1, y1;
+} rdpq_paragraph_bbox_t;
+
+/* Top-left corner of one glyph cell, relative to the paragraph origin */
+typedef struct
+{
+    float x, y;
+} rdpq_paragraph_char_t;
+
+typedef struct
+{
+    rdpq_paragraph_bbox_t bbox;
+    int nchars;
+    uint8_t font_id;
+    uint8_t style_id;
+    rdpq_paragraph_char_t chars[];
+} rdpq_paragraph_t;
+
+rdpq_font_t *rdpq_font_load(const char *path);
+
+void rdpq_font_style(rdpq_font_t *font, uint8_t style_id, const rdpq_fontstyle_t *style);
+
+void rdpq_text_register_font(uint8_t font_id, const rdpq_font_t *font);
+
+const rdpq_font_t *rdpq_text_get_font(uint8_t font_id);
+
+rdpq_paragraph_t *rdpq_paragraph_build(const rdpq_textparms_t *parms, uint8_t initial_font_id,
+    const char *utf8_text, int *nbytes);
+
+void rdpq_paragraph_render(const rdpq_paragraph_t *layout, float x0, float y0);
+
+void rdpq_paragraph_free(rdpq_paragraph_t *layout);
+
+#endif
@@ -0,0 +1,677 @@
+/**
+ * FlappyBird-N64 - rdpq.c (rdpsim)
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ *
+ * A software RDP for the rdpq calls the game makes. It is not bit-exact:
+ * there is no dithering or coverage anti-aliasing, and filtering is a plain
+ * 4-tap bilinear. What it does get right is which pixels each primitive
+ * covers and which of those pass the alpha compare, so it can count every
+ * write, where it lands and how often each pixel is drawn.
+ */
+
+#include <math.h>
+
+#include "rdpsim.h"
+
+/* RDP definitions */
+
+#define RDP_TILES_COUNT     8
+#define RDP_TLUT_ENTRIES    256
+#define RDP_FONTS_COUNT     256
+#define RDP_FONT_STYLES     256
+
+/* Fill and copy mode write 64 bits per clock; TMEM loads move as much */
+#define RDP_FAST_PIXELS_PER_CLOCK   4
+#define RDP_LOAD_BYTES_PER_CLOCK    8
+
+/* AT01 cell metrics at 1x (16 px); glyphs are drawn as solid boxes this size */
+#define RDP_FONT_ADVANCE    8
+#define RDP_FONT_GLYPH_W    7
+#define RDP_FONT_ASCENT     10
+#define RDP_FONT_DESCENT    3
+
+typedef enum
+{
+    RDP_CYCLE_FILL,
+    RDP_CYCLE_COPY,
+    RDP_CYCLE_STANDARD,
+} rdp_cycle_t;
+
+typedef struct rdp_tile_s
+{
+    surface_t surface;
+    int s0, t0, s1, t1;     // Loaded area, in texels of the surface
+    int palette;            // CI4 TLUT bank
+    bool repeat_s, repeat_t;
+    bool mirror_s, mirror_t;
+} rdp_tile_t;
+
+/* Maps a point on screen back to texel coordinates */
+typedef struct rdp_texmap_s
+{
+    float x0, y0;   // Screen position of (s0, t0)
+    float s0, t0;
+    float dsdx, dsdy;
+    float dtdx, dtdy;
+} rdp_texmap_t;
+
+typedef struct rdp_mode_s
+{
+    rdp_cycle_t cycle;
+    color_t fill_color;
+    int alpha_threshold;
+    bool copy_transparency;
+    bool blend;
+    bool flat;
+    bool bilinear;
+} rdp_mode_t;
+
+struct rdpq_font_s
+{
+    int scale;
+    rdpq_fontstyle_t styles[RDP_FONT_STYLES];
+};
+
+static struct rdp_s
+{
+    bool attached;
+    surface_t target;
+    bool target_display;
+    bool clearing;
+    rdp_mode_t mode;
+    color_t prim_color;
+    // TMEM
+    uint16_t tlut[RDP_TLUT_ENTRIES];
+    rdp_tile_t tiles[RDP_TILES_COUNT];
+    const rdpq_font_t *fonts[RDP_FONTS_COUNT];
+    // Accounting
+    rdpsim_layer_t layer;
+    rdpsim_stats_t stats[RDPSIM_LAYERS_COUNT];
+    uint8_t *coverage;
+    int coverage_w;
+    int coverage_h;
+} rdp = {0};
+
+/* Accounting */
+
+void rdpsim_set_layer(rdpsim_layer_t layer)
+{
+    assert(layer < RDPSIM_LAYERS_COUNT);
+    rdp.layer = layer;
+}
+
+const rdpsim_stats_t *rdpsim_get_stats(rdpsim_layer_t layer)
+{
+    assert(layer < RDPSIM_LAYERS_COUNT);
+    return &rdp.stats[layer];
+}
+
+/* Non-clear writes per display pixel, since the display was last cleared */
+const uint8_t *rdpsim_get_coverage(void)
+{
+    return rdp.coverage;
+}
+
+static rdpsim_stats_t *rdp_stats(void)
+{
+    if (!rdp.target_display) return &rdp.stats[RDPSIM_LAYER_OFFSCREEN];
+    if (rdp.clearing) return &rdp.stats[RDPSIM_LAYER_CLEAR];
+    return &rdp.stats[rdp.layer];
+}
+
+/* Starts a frame: on-screen statistics and coverage cover one frame each */
+static void rdp_frame_begin(void)
+{
+    for (int layer = 0; layer < RDPSIM_LAYERS_COUNT; layer++)
+    {
+        if (layer == RDPSIM_LAYER_OFFSCREEN) continue;
+        memset(&rdp.stats[layer], 0, sizeof(rdpsim_stats_t));
+    }
+    if (rdp.coverage_w != rdp.target.width || rdp.coverage_h != rdp.target.height)
+    {
+        free(rdp.coverage);
+        rdp.coverage_w = rdp.target.width;
+        rdp.coverage_h = rdp.target.height;
+        rdp.coverage = malloc(rdp.coverage_w * rdp.coverage_h);
+    }
+    memset(rdp.coverage, 0, rdp.coverage_w * rdp.coverage_h);
+}
+
+static void rdp_load_bytes(int bytes)
+{
+    rdpsim_stats_t *const stats = rdp_stats();
+    stats->tmem_bytes += bytes;
+    stats->cycles += (bytes + RDP_LOAD_BYTES_PER_CLOCK - 1) / RDP_LOAD_BYTES_PER_CLOCK;
+}
+
+/* Texturing */
+
+static int rdp_wrap(int coord, int size, bool repeat, bool mirror)
+{
+    if (!repeat)
+    {
+        return coord < 0 ? 0 : (coord >= size ? size - 1 : coord);
+    }
+    const int period = mirror ? size * 2 : size;
+    coord %= period;
+    if (coord < 0) coord += period;
+    return coord < size ? coord : period - 1 - coord;
+}
+
+static color_t rdp_texel(const rdp_tile_t *tile, int s, int t)
+{
+    s = tile->s0 + rdp_wrap(s - tile->s0, tile->s1 - tile->s0, tile->repeat_s, tile->mirror_s);
+    t = tile->t0 + rdp_wrap(t - tile->t0, tile->t1 - tile->t0, tile->repeat_t, tile->mirror_t);
+    const surface_t *const surf = &tile->surface;
+    const uint8_t *const row = (const uint8_t *)surf->buffer + t * surf->stride;
+    const int nibble = (s & 1) ? (row[s / 2] & 0xF) : (row[s / 2] >> 4);
+    switch (surface_get_format(surf))
+    {
+    case FMT_RGBA16:
+        return color_from_packed16(((const uint16_t *)row)[s]);
+    case FMT_RGBA32:
+        return RGBA32(row[s * 4], row[s * 4 + 1], row[s * 4 + 2], row[s * 4 + 3]);
+    case FMT_CI4:
+        return color_from_packed16(rdp.tlut[tile->palette * 16 + nibble]);
+    case FMT_CI8:
+        return color_from_packed16(rdp.tlut[row[s]]);
+    case FMT_I4:
+        return RGBA32(nibble * 17, nibble * 17, nibble * 17, nibble * 17);
+    case FMT_I8:
+        return RGBA32(row[s], row[s], row[s], row[s]);
+    default:
+        return RGBA32(0, 0, 0, 0);
+    }
+}
+
+static color_t rdp_sample(const rdp_tile_t *tile, float s, float t)
+{
+    if (!rdp.mode.bilinear || rdp.mode.cycle == RDP_CYCLE_COPY)
+    {
+        return rdp_texel(tile, (int)floorf(s), (int)floorf(t));
+    }
+    s -= 0.5f;
+    t -= 0.5f;
+    const int s0 = (int)floorf(s), t0 = (int)floorf(t);
+    const float fs = s - s0, ft = t - t0;
+    const color_t taps[4] = {
+        rdp_texel(tile, s0, t0), rdp_texel(tile, s0 + 1, t0),
+        rdp_texel(tile, s0, t0 + 1), rdp_texel(tile, s0 + 1, t0 + 1),
+    };
+    const float weights[4] = {
+        (1 - fs) * (1 - ft), fs * (1 - ft), (1 - fs) * ft, fs * ft,
+    };
+    float r = 0.5f, g = 0.5f, b = 0.5f, a = 0.5f;
+    for (int i = 0; i < 4; i++)
+    {
+        r += taps[i].r * weights[i];
+        g += taps[i].g * weights[i];
+        b += taps[i].b * weights[i];
+        a += taps[i].a * weights[i];
+    }
+    return RGBA32((uint8_t)r, (uint8_t)g, (uint8_t)b, (uint8_t)a);
+}
+
+/* Rasterizer */
+
+static uint16_t *rdp_pixel(int x, int y)
+{
+    return (uint16_t *)((uint8_t *)rdp.target.buffer + y * rdp.target.stride) + x;
+}
+
+static void rdp_store(rdpsim_stats_t *stats, int x, int y, color_t color)
+{
+    *rdp_pixel(x, y) = color_to_packed16(color);
+    stats->writes++;
+    if (!rdp.target_display || rdp.clearing) return;
+    uint8_t *const coverage = &rdp.coverage[y * rdp.coverage_w + x];
+    if (*coverage) stats->overdraw++;
+    if (*coverage < UINT8_MAX) (*coverage)++;
+}
+
+/* Runs one covered pixel through the combiner, alpha compare and blender */
+static void rdp_shade(rdpsim_stats_t *stats, int x, int y, const rdp_tile_t *tile, float s, float t)
+{
+    color_t color;
+    switch (rdp.mode.cycle)
+    {
+    case RDP_CYCLE_FILL:
+        rdp_store(stats, x, y, rdp.mode.fill_color);
+        return;
+    case RDP_CYCLE_COPY:
+        color = rdp_sample(tile, s, t);
+        stats->texels++;
+        if (rdp.mode.copy_transparency && color.a == 0) return;
+        rdp_store(stats, x, y, color);
+        return;
+    default:
+        break;
+    }
+    if (tile && !rdp.mode.flat)
+    {
+        color = rdp_sample(tile, s, t);
+        stats->texels += rdp.mode.bilinear ? 4 : 1;
+    }
+    else
+    {
+        color = rdp.prim_color;
+    }
+    if (rdp.mode.alpha_threshold && color.a < rdp.mode.alpha_threshold) return;
+    if (rdp.mode.blend)
+    {
+        const color_t dst = color_from_packed16(*rdp_pixel(x, y));
+        const int a = color.a;
+        color.r = (color.r * a + dst.r * (255 - a)) / 255;
+        color.g = (color.g * a + dst.g * (255 - a)) / 255;
+        color.b = (color.b * a + dst.b * (255 - a)) / 255;
+    }
+    /* Whatever the pipeline draws is opaque to a later copy-mode blit */
+    color.a = 0xFF;
+    rdp_store(stats, x, y, color);
+}
+
+/*
+ * Rasterizes [x0, x1) x [y0, y1), clipped to the target; a pixel is covered
+ * when its top-left corner is inside. Textured pixels map their centers back
+ * through `map`. When `bounded`, pixels that map outside the tile's loaded
+ * area are not covered, which is what gives rotated blits their outline.
+ */
+static void rdp_draw(float x0, float y0, float x1, float y1,
+    const rdp_tile_t *tile, const rdp_texmap_t *map, bool bounded)
+{
+    if (!rdp.attached) return;
+    rdpsim_stats_t *const stats = rdp_stats();
+    stats->prims++;
+    int ix0 = (int)ceilf(x0), iy0 = (int)ceilf(y0);
+    int ix1 = (int)ceilf(x1), iy1 = (int)ceilf(y1);
+    if (ix0 < 0) ix0 = 0;
+    if (iy0 < 0) iy0 = 0;
+    if (ix1 > rdp.target.width) ix1 = rdp.target.width;
+    if (iy1 > rdp.target.height) iy1 = rdp.target.height;
+    for (int y = iy0; y < iy1; y++)
+    {
+        int covered = 0;
+        for (int x = ix0; x < ix1; x++)
+        {
+            float s = 0, t = 0;
+            if (tile)
+            {
+                const float dx = x + 0.5f - map->x0, dy = y + 0.5f - map->y0;
+                s = map->s0 + dx * map->dsdx + dy * map->dsdy;
+                t = map->t0 + dx * map->dtdx + dy * map->dtdy;
+                if (bounded && (s < tile->s0 || s >= tile->s1 || t < tile->t0 || t >= tile->t1))
+                {
+                    continue;
+                }
+            }
+            covered++;
+            rdp_shade(stats, x, y, tile, s, t);
+        }
+        stats->pixels += covered;
+        if (rdp.mode.cycle == RDP_CYCLE_STANDARD)
+        {
+            stats->cycles += covered;
+        }
+        else
+        {
+            stats->cycles += (covered + RDP_FAST_PIXELS_PER_CLOCK - 1) / RDP_FAST_PIXELS_PER_CLOCK;
+        }
+    }
+}
+
+/* Modes */
+
+void rdpq_init(void)
+{
+    memset(&rdp.mode, 0, sizeof(rdp.mode));
+    rdp.mode.cycle = RDP_CYCLE_STANDARD;
+}
+
+void rdpq_set_mode_fill(color_t color)
+{
+    rdp.mode.cycle = RDP_CYCLE_FILL;
+    rdp.mode.fill_color = color;
+}
+
+void rdpq_set_mode_copy(bool transparency)
+{
+    rdp.mode.cycle = RDP_CYCLE_COPY;
+    rdp.mode.copy_transparency = transparency;
+}
+
+void rdpq_set_mode_standard(void)
+{
+    rdp.mode = (rdp_mode_t){ .cycle = RDP_CYCLE_STANDARD };
+}
+
+void rdpq_mode_alphacompare(int threshold)
+{
+    rdp.mode.alpha_threshold = threshold;
+}
+
+void rdpq_mode_blender(rdpq_blender_t blend)
+{
+    rdp.mode.blend = (blend == RDPQ_BLENDER_MULTIPLY);
+}
+
+void rdpq_mode_combiner(rdpq_combiner_t comb)
+{
+    rdp.mode.flat = (comb == RDPQ_COMBINER_FLAT);
+}
+
+void rdpq_mode_filter(rdpq_filter_t filter)
+{
+    rdp.mode.bilinear = (filter != FILTER_POINT);
+}
+
+/* Color-indexed texels always go through the TLUT here */
+void rdpq_mode_tlut(rdpq_tlut_t tlut)
+{
+    (void)tlut;
+}
+
+void rdpq_set_prim_color(color_t color)
+{
+    rdp.prim_color = color;
+}
+
+/* Render targets */
+
+void rdpq_attach(const surface_t *surf_color, const surface_t *surf_z)
+{
+    (void)surf_z;
+    assert(surface_get_format(surf_color) == FMT_RGBA16);
+    rdp.target = *surf_color;
+    rdp.target_display = rdpsim_is_display(surf_color);
+    rdp.attached = true;
+}
+
+void rdpq_attach_clear(const surface_t *surf_color, const surface_t *surf_z)
+{
+    rdpq_attach(surf_color, surf_z);
+    if (rdp.target_display) rdp_frame_begin();
+    rdpq_clear(RGBA32(0x00, 0x00, 0x00, 0xFF));
+}
+
+void rdpq_detach(void)
+{
+    rdp.attached = false;
+}
+
+void rdpq_detach_wait(void)
+{
+    rdpq_detach();
+}
+
+void rdpq_detach_cb(void (*cb)(void *), void *arg)
+{
+    rdpq_detach();
+    cb(arg);
+}
+
+bool rdpq_is_attached(void)
+{
+    return rdp.attached;
+}
+
+/* A fill rectangle over the whole target that leaves the render mode alone */
+void rdpq_clear(color_t color)
+{
+    const rdp_mode_t mode = rdp.mode;
+    rdpq_set_mode_fill(color);
+    rdp.clearing = true;
+    rdp_draw(0, 0, rdp.target.width, rdp.target.height, NULL, NULL, false);
+    rdp.clearing = false;
+    rdp.mode = mode;
+}
+
+/* Everything here has finished by the time the call returns */
+void rdpq_call_deferred(void (*func)(void *), void *arg)
+{
+    func(arg);
+}
+
+/* Textures */
+
+static int rdp_tile_load(rdpq_tile_t tile, const surface_t *tex, const rdpq_texparms_t *parms,
+    int s0, int t0, int s1, int t1)
+{
+    const rdpq_texparms_t defaults = {0};
+    if (parms == NULL) parms = &defaults;
+    rdp.tiles[tile] = (rdp_tile_t){
+        .surface = *tex,
+        .s0 = s0, .t0 = t0, .s1 = s1, .t1 = t1,
+        .palette = parms->palette,
+        .repeat_s = parms->s.repeats > 1,
+        .repeat_t = parms->t.repeats > 1,
+        .mirror_s = parms->s.mirror,
+        .mirror_t = parms->t.mirror,
+    };
+    /* Direct-color sprites are read from PNGs; the ROM stores them at 16 bpp or less */
+    tex_format_t format = surface_get_format(tex);
+    if (format == FMT_RGBA32) format = FMT_RGBA16;
+    const int bytes = TEX_FORMAT_PIX2BYTES(format, s1 - s0) * (t1 - t0);
+    rdp_load_bytes(bytes);
+    return bytes;
+}
+
+int rdpq_tex_upload(rdpq_tile_t tile, const surface_t *tex, const rdpq_texparms_t *parms)
+{
+    return rdp_tile_load(tile, tex, parms, 0, 0, tex->width, tex->height);
+}
+
+int rdpq_tex_upload_sub(rdpq_tile_t tile, const surface_t *tex, const rdpq_texparms_t *parms,
+    int s0, int t0, int s1, int t1)
+{
+    return rdp_tile_load(tile, tex, parms, s0, t0, s1, t1);
+}
+
+void rdpq_tex_upload_tlut(uint16_t *tlut, int color_idx, int num_colors)
+{
+    assert(color_idx >= 0 && color_idx + num_colors <= RDP_TLUT_ENTRIES);
+    memcpy(&rdp.tlut[color_idx], tlut, num_colors * sizeof(uint16_t));
+    rdp_load_bytes(num_colors * sizeof(uint16_t));
+}
+
+void rdpq_tex_multi_begin(void)
+{
+}
+
+int rdpq_tex_multi_end(void)
+{
+    return 0;
+}
+
+int rdpq_sprite_upload(rdpq_tile_t tile, sprite_t *sprite, const rdpq_texparms_t *parms)
+{
+    return rdpq_tex_upload(tile, &sprite->pixels, parms);
+}
+
+/*
+ * Loads the blitted area and draws it with (cx, cy) landing on (x0, y0).
+ * Rotation turns the same way as bird_build_rotated expects of it.
+ */
+void rdpq_tex_blit(const surface_t *surf, float x0, float y0, const rdpq_blitparms_t *parms)
+{
+    const rdpq_blitparms_t defaults = {0};
+    if (parms == NULL) parms = &defaults;
+    const int width = parms->width ? parms->width : surf->width - parms->s0;
+    const int height = parms->height ? parms->height : surf->height - parms->t0;
+    const float sx = parms->scale_x ? parms->scale_x : 1.0f;
+    const float sy = parms->scale_y ? parms->scale_y : 1.0f;
+    rdp_tile_load(parms->tile, surf, NULL, parms->s0, parms->t0,
+        parms->s0 + width, parms->t0 + height);
+    const rdp_tile_t *const tile = &rdp.tiles[parms->tile];
+
+    const float c = cosf(parms->theta), s = sinf(parms->theta);
+    rdp_texmap_t map = {
+        .x0 = x0, .y0 = y0,
+        .s0 = parms->s0 + parms->cx, .t0 = parms->t0 + parms->cy,
+        .dsdx = c / sx, .dsdy = -s / sx,
+        .dtdx = s / sy, .dtdy = c / sy,
+    };
+    if (parms->flip_x)
+    {
+        map.s0 = parms->s0 + width - parms->cx;
+        map.dsdx = -map.dsdx;
+        map.dsdy = -map.dsdy;
+    }
+    if (parms->flip_y)
+    {
+        map.t0 = parms->t0 + height - parms->cy;
+        map.dtdx = -map.dtdx;
+        map.dtdy = -map.dtdy;
+    }
+
+    /* Screen bounds of the transformed rectangle */
+    float bx0 = INFINITY, by0 = INFINITY, bx1 = -INFINITY, by1 = -INFINITY;
+    for (int corner = 0; corner < 4; corner++)
+    {
+        const float u = ((corner & 1) ? width : 0) - parms->cx;
+        const float v = ((corner & 2) ? height : 0) - parms->cy;
+        const float x = x0 + c * u * sx + s * v * sy;
+        const float y = y0 - s * u * sx + c * v * sy;
+        if (x < bx0) bx0 = x;
+        if (x > bx1) bx1 = x;
+        if (y < by0) by0 = y;
+        if (y > by1) by1 = y;
+    }
+    rdp_draw(bx0, by0, bx1, by1, tile, &map, parms->theta != 0.0f);
+}
+
+void rdpq_sprite_blit(sprite_t *sprite, float x0, float y0, const rdpq_blitparms_t *parms)
+{
+    rdpq_tex_blit(&sprite->pixels, x0, y0, parms);
+}
+
+/* Primitives */
+
+void rdpq_fill_rectangle(float x0, float y0, float x1, float y1)
+{
+    rdp_draw(x0, y0, x1, y1, NULL, NULL, false);
+}
+
+void rdpq_texture_rectangle_scaled(rdpq_tile_t tile, float x0, float y0, float x1, float y1,
+    float s0, float t0, float s1, float t1)
+{
+    if (x1 <= x0 || y1 <= y0) return;
+    const rdp_texmap_t map = {
+        .x0 = x0, .y0 = y0,
+        .s0 = s0, .t0 = t0,
+        .dsdx = (s1 - s0) / (x1 - x0),
+        .dtdy = (t1 - t0) / (y1 - y0),
+    };
+    rdp_draw(x0, y0, x1, y1, &rdp.tiles[tile], &map, false);
+}
+
+/* Text */
+
+rdpq_font_t *rdpq_font_load(const char *path)
+{
+    rdpq_font_t *const font = calloc(1, sizeof(rdpq_font_t));
+    font->scale = strstr(path, "-2x") ? 2 : 1;
+    return font;
+}
+
+void rdpq_font_style(rdpq_font_t *font, uint8_t style_id, const rdpq_fontstyle_t *style)
+{
+    font->styles[style_id] = *style;
+}
+
+void rdpq_text_register_font(uint8_t font_id, const rdpq_font_t *font)
+{
+    rdp.fonts[font_id] = font;
+}
+
+const rdpq_font_t *rdpq_text_get_font(uint8_t font_id)
+{
+    return rdp.fonts[font_id];
+}
+
+/* One glyph cell per printable character; the origin is the first baseline */
+rdpq_paragraph_t *rdpq_paragraph_build(const rdpq_textparms_t *parms, uint8_t initial_font_id,
+    const char *utf8_text, int *nbytes)
+{
+    const rdpq_font_t *const font = rdp.fonts[initial_font_id];
+    assert(font != NULL);
+    const int advance = RDP_FONT_ADVANCE * font->scale;
+    const int line_h = (RDP_FONT_ASCENT + RDP_FONT_DESCENT) * font->scale;
+    rdpq_paragraph_t *const layout = calloc(1, sizeof(rdpq_paragraph_t) +
+        *nbytes * sizeof(rdpq_paragraph_char_t));
+    layout->font_id = initial_font_id;
+    layout->style_id = parms->style_id;
+
+    int line_start = 0, column = 0, lines = 1, widest = 0;
+    for (int i = 0; i <= *nbytes; i++)
+    {
+        const char ch = (i < *nbytes) ? utf8_text[i] : '\n';
+        if (ch != '\n')
+        {
+            if (ch != ' ')
+            {
+                layout->chars[layout->nchars++] = (rdpq_paragraph_char_t){
+                    .x = column * advance,
+                    .y = (lines - 1) * line_h - RDP_FONT_ASCENT * font->scale,
+                };
+            }
+            column++;
+            continue;
+        }
+        /* Align the finished line within the box */
+        const int line_w = column * advance;
+        float shift = 0;
+        if (parms->width && parms->align == ALIGN_RIGHT) shift = parms->width - line_w;
+        if (parms->width && parms->align == ALIGN_CENTER) shift = (parms->width - line_w) / 2;
+        for (int c = line_start; c < layout->nchars; c++)
+        {
+            layout->chars[c].x += shift;
+        }
+        if (line_w > widest) widest = line_w;
+        line_start = layout->nchars;
+        column = 0;
+        if (i < *nbytes) lines++;
+    }
+
+    float x0 = 0, x1 = widest;
+    if (parms->width && parms->align == ALIGN_RIGHT) x0 = parms->width - widest;
+    if (parms->width && parms->align == ALIGN_CENTER) x0 = (parms->width - widest) / 2;
+    if (parms->width && parms->align != ALIGN_LEFT) x1 = x0 + widest;
+    layout->bbox = (rdpq_paragraph_bbox_t){
+        .x0 = x0,
+        .y0 = -RDP_FONT_ASCENT * font->scale,
+        .x1 = x1,
+        .y1 = (lines - 1) * line_h + RDP_FONT_DESCENT * font->scale,
+    };
+    return layout;
+}
+
+/* Glyphs are textured rectangles on the RDP; here they are the style's color */
+void rdpq_paragraph_render(const rdpq_paragraph_t *layout, float x0, float y0)
+{
+    const rdpq_font_t *const font = rdp.fonts[layout->font_id];
+    const rdp_mode_t mode = rdp.mode;
+    const color_t prim_color = rdp.prim_color;
+    rdp.mode = (rdp_mode_t){ .cycle = RDP_CYCLE_STANDARD, .flat = true, .alpha_threshold = 1 };
+    rdp.prim_color = font->styles[layout->style_id].color;
+    rdpsim_stats_t *const stats = rdp_stats();
+    const long pixels = stats->pixels;
+    const int glyph_w = RDP_FONT_GLYPH_W * font->scale;
+    const int glyph_h = RDP_FONT_ASCENT * font->scale;
+    for (int i = 0; i < layout->nchars; i++)
+    {
+        const float x = x0 + layout->chars[i].x, y = y0 + layout->chars[i].y;
+        rdp_draw(x, y, x + glyph_w, y + glyph_h, NULL, NULL, false);
+    }
+    stats->texels += stats->pixels - pixels;
+    rdp.mode = mode;
+    rdp.prim_color = prim_color;
+}
+
+void rdpq_paragraph_free(rdpq_paragraph_t *layout)
+{
+    free(layout);
+}
@@ -0,0 +1,473 @@
+/**
+ * FlappyBird-N64 - rdpsim.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ *
+ * Runs the game's own simulation and drawing code on the host against a
+ * software RDP, and reports what one frame costs the RDP: primitives,
+ * pixels, overdraw, texel fetches and TMEM loads per layer, plus an
+ * estimate of the clocks it all takes.
+ *
+ * Usage:
+ *   rdpsim [-s scene] [-r res] [-w] [-n] [-f frames] [-k score] [-S seed]
+ *          [-o frame.ppm] [-m overdraw.ppm] [-p png_dir] [-g gen_dir]
+ *          [-d rom_dir] [-v]
+ *
+ * Scenes are title, ready, play (default) and dead. The game boots to the
+ * title screen and sits there for a few seconds, so offscreen bakes and any
+ * day/night fade are done; then rdpsim presses A as a player would to reach
+ * the scene, flying the bird through the gaps in play, and holds the scene
+ * for -f frames before drawing the frame it reports on. Resolutions are
+ * low, field and high (the menu's Hi-Res choices); -w is widescreen and -n
+ * night. -k pins the score shown, so wide scores can be measured.
+ *
+ * -o writes the frame and -m a heat map of how often each pixel was drawn
+ * (black, blue, green, yellow, red, white for 0 to 5+ times; the clear is
+ * not counted), both as binary PPM. Assets come from the same places the
+ * Makefile puts them; the ROM filesystem (-d) must already be built.
+ */
+
+#include <math.h>
+
+#include "rdpsim.h"
+
+#include "gfx.h"
+#include "sfx.h"
+
+#include "bg.h"
+#include "bird.h"
+#include "blackbox.h"
+#include "collision.h"
+#include "fps.h"
+#include "input.h"
+#include "pace.h"
+#include "pipes.h"
+#include "rdpmon.h"
+#include "ui.h"
+
+/* Simulator definitions */
+
+#define RDPSIM_HZ               60
+#define RDPSIM_FRAME_TICKS      (TICKS_PER_SECOND / RDPSIM_HZ)
+#define RDPSIM_FRAME_US         (1000000 / RDPSIM_HZ)
+#define RDPSIM_WARMUP_FRAMES    240     // Longer than a day/night fade
+#define RDPSIM_MAX_FRAMES       36000   // Give up on a scene after ten minutes
+#define RDPSIM_DEAD_FLIGHT      90      // Frames flown before the dead scene crashes
+
+/* The autopilot aims just below the middle of the next gap */
+#define RDPSIM_PIPE_HALF_WIDTH  ((float)0.06)
+#define RDPSIM_AUTOPILOT_MARGIN ((float)0.08)
+
+typedef enum
+{
+    RDPSIM_SCENE_TITLE,
+    RDPSIM_SCENE_READY,
+    RDPSIM_SCENE_PLAY,
+    RDPSIM_SCENE_DEAD,
+    // Additional scenes go above this line
+    RDPSIM_SCENES_COUNT // Not a scene; just a count
+} rdpsim_scene_t;
+
+// These arrays must line up with rdpsim_scene_t
+static const char *const RDPSIM_SCENE_NAMES[RDPSIM_SCENES_COUNT] = {
+    "title", "ready", "play", "dead",
+};
+static const bird_state_t RDPSIM_SCENE_STATES[RDPSIM_SCENES_COUNT] = {
+    BIRD_STATE_TITLE, BIRD_STATE_READY, BIRD_STATE_PLAY, BIRD_STATE_DEAD,
+};
+static const int RDPSIM_SCENE_HOLD_FRAMES[RDPSIM_SCENES_COUNT] = {
+    0, 60, 300, 150,
+};
+
+// This array must line up with rdpsim_layer_t
+static const char *const RDPSIM_LAYER_NAMES[RDPSIM_LAYERS_COUNT] = {
+    "offscreen", "clear", "sky", "pipes", "bird", "ground", "ui",
+};
+
+// This array must line up with gfx_res_mode_t
+static const char *const RDPSIM_RES_NAMES[GFX_RES_MODES_COUNT] = {
+    "low", "high", "field", NULL,
+};
+
+/* Heat map colors for 0 through RDPSIM_COVERAGE_MAX writes */
+static const uint8_t RDPSIM_HEAT_COLORS[RDPSIM_COVERAGE_MAX + 1][3] = {
+    { 0x00, 0x00, 0x00 },
+    { 0x20, 0x40, 0xFF },
+    { 0x20, 0xC0, 0x40 },
+    { 0xFF, 0xE0, 0x20 },
+    { 0xFF, 0x30, 0x20 },
+    { 0xFF, 0xFF, 0xFF },
+};
+
+static struct rdpsim_s
+{
+    rdpsim_scene_t scene;
+    int frames;         // Since the warmup
+    int play_frames;    // Spent in BIRD_STATE_PLAY
+    int score;          // Pinned score, or -1
+    input_edge_t edge;
+    size_t edge_count;
+    pace_rate_t pace_rate;
+    bool fps_visible;
+} sim = {
+    .scene = RDPSIM_SCENE_PLAY,
+    .score = -1,
+};
+
+/* Game stand-ins; there is no audio, black box or frame pacing to talk to */
+
+void sfx_play(sfx_id_t sfx_id)
+{
+    (void)sfx_id;
+}
+
+void blackbox_event(blackbox_event_t event)
+{
+    (void)event;
+}
+
+void rdpmon_block_begin(void)
+{
+}
+
+void rdpmon_block_end(void)
+{
+}
+
+int fps_get_misses(void)
+{
+    return 0;
+}
+
+void fps_set_visible(bool visible)
+{
+    sim.fps_visible = visible;
+}
+
+bool fps_get_visible(void)
+{
+    return sim.fps_visible;
+}
+
+void pace_set_rate(pace_rate_t rate)
+{
+    sim.pace_rate = rate;
+}
+
+pace_rate_t pace_get_rate(void)
+{
+    return sim.pace_rate;
+}
+
+int pace_get_hz(void)
+{
+    return RDPSIM_HZ >> sim.pace_rate;
+}
+
+int pace_get_interval_vblanks(void)
+{
+    return (sim.pace_rate == PACE_RATE_HALF) ? 2 : 1;
+}
+
+/* At most one press per frame, landing at the start of its tick */
+size_t input_get_edges(const input_edge_t **edges)
+{
+    *edges = &sim.edge;
+    return sim.edge_count;
+}
+
+/* Simulator implementation */
+
+static void rdpsim_die(const char *fmt, const char *arg)
+{
+    fprintf(stderr, "rdpsim: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static int rdpsim_parse_name(const char *const *names, int count, const char *name)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (names[i] && strcmp(names[i], name) == 0) return i;
+    }
+    rdpsim_die("unknown name: %s", name);
+    return -1;
+}
+
+/* Flaps whenever the bird sinks below the middle of the gap ahead */
+static bool rdpsim_autopilot(const bird_t *bird, const pipes_t *pipes)
+{
+    float target = 0.0f;
+    float nearest = INFINITY;
+    for (size_t i = 0; i < pipes->count; i++)
+    {
+        const pipe_t *const pipe = &pipes->n[i];
+        if (pipe->x + RDPSIM_PIPE_HALF_WIDTH > bird->x && pipe->x < nearest)
+        {
+            nearest = pipe->x;
+            target = pipe->y;
+        }
+    }
+    return bird->dy >= 0 && bird->y > target + RDPSIM_AUTOPILOT_MARGIN;
+}
+
+/* The presses a player would make to get to the scene, and to stay there */
+static joypad_buttons_t rdpsim_buttons(const bird_t *bird, const pipes_t *pipes)
+{
+    joypad_buttons_t buttons = {0};
+    if (sim.frames < RDPSIM_WARMUP_FRAMES || sim.scene == RDPSIM_SCENE_TITLE) return buttons;
+    switch (bird->state)
+    {
+    case BIRD_STATE_TITLE:
+        buttons.a = true;
+        break;
+    case BIRD_STATE_READY:
+        buttons.a = (sim.scene >= RDPSIM_SCENE_PLAY);
+        break;
+    case BIRD_STATE_PLAY:
+        if (sim.scene == RDPSIM_SCENE_DEAD && sim.play_frames > RDPSIM_DEAD_FLIGHT) break;
+        buttons.a = rdpsim_autopilot(bird, pipes);
+        break;
+    default:
+        break;
+    }
+    return buttons;
+}
+
+/* One tick of the main loop in main.c, minus audio and telemetry */
+static void rdpsim_tick(bird_t *bird, pipes_t *pipes, ui_t *ui)
+{
+    rdpsim_advance_ticks(RDPSIM_FRAME_TICKS);
+    gfx_tick();
+
+    const joypad_buttons_t buttons = rdpsim_buttons(bird, pipes);
+    sim.edge = (input_edge_t){ .ticks = get_ticks(), .pressed = buttons };
+    sim.edge_count = buttons.raw ? 1 : 0;
+
+    const bird_state_t prev_bird_state = bird->state;
+    bird_tick(bird, &buttons);
+    if (prev_bird_state != bird->state && prev_bird_state == BIRD_STATE_DEAD)
+    {
+        bg_randomize_time_mode();
+        pipes_reset(pipes);
+    }
+    switch (bird->state)
+    {
+    case BIRD_STATE_TITLE:
+        ui_menu_tick(ui, bird, &buttons);
+        bg_tick(&buttons);
+        break;
+    case BIRD_STATE_READY:
+        bg_tick(&buttons);
+        break;
+    case BIRD_STATE_PLAY:
+        bg_tick(&buttons);
+        pipes_tick(pipes);
+        collision_tick(bird, pipes);
+        sim.play_frames++;
+        break;
+    default:
+        break;
+    }
+    if (sim.score >= 0) bird->score = sim.score;
+    ui_tick(ui, bird);
+    sim.frames++;
+}
+
+/* game_draw in main.c, with each part charged to its layer */
+static void rdpsim_draw(const bird_t *bird, const pipes_t *pipes, const ui_t *ui)
+{
+    gfx_display_lock();
+    rdpsim_set_layer(RDPSIM_LAYER_SKY);
+    bg_draw_sky();
+    rdpsim_set_layer(RDPSIM_LAYER_PIPES);
+    pipes_draw(pipes);
+    rdpsim_set_layer(RDPSIM_LAYER_BIRD);
+    bird_draw(bird);
+    rdpsim_set_layer(RDPSIM_LAYER_GROUND);
+    bg_draw_ground();
+    rdpsim_set_layer(RDPSIM_LAYER_UI);
+    ui_draw(ui);
+    gfx_display_show();
+}
+
+static void rdpsim_stats_add(rdpsim_stats_t *total, const rdpsim_stats_t *stats)
+{
+    total->prims += stats->prims;
+    total->pixels += stats->pixels;
+    total->writes += stats->writes;
+    total->overdraw += stats->overdraw;
+    total->texels += stats->texels;
+    total->tmem_bytes += stats->tmem_bytes;
+    total->cycles += stats->cycles;
+}
+
+static void rdpsim_print_stats(const char *name, const rdpsim_stats_t *stats)
+{
+    printf("%-10s %7ld %9ld %9ld %9ld %9ld %8ld %9ld %7d\n", name,
+        stats->prims, stats->pixels, stats->writes, stats->overdraw,
+        stats->texels, stats->tmem_bytes, stats->cycles, RDPMON_CYCLES_TO_US(stats->cycles));
+}
+
+static void rdpsim_report(const bird_t *bird)
+{
+    const int screen = gfx->width * gfx->height;
+    printf("%s scene, %dx%d%s, %s, score %d, frame %d after the title\n",
+        RDPSIM_SCENE_NAMES[sim.scene], gfx->width, gfx->height,
+        gfx->widescreen ? " widescreen" : "",
+        bg_get_time_mode() == BG_TIME_NIGHT ? "night" : "day",
+        bird->score, sim.frames - RDPSIM_WARMUP_FRAMES);
+    printf("%-10s %7s %9s %9s %9s %9s %8s %9s %7s\n", "layer",
+        "prims", "pixels", "writes", "overdraw", "texels", "tmem B", "cycles", "us");
+
+    rdpsim_stats_t total = {0};
+    for (int layer = RDPSIM_LAYER_CLEAR; layer < RDPSIM_LAYERS_COUNT; layer++)
+    {
+        const rdpsim_stats_t *const stats = rdpsim_get_stats(layer);
+        rdpsim_print_stats(RDPSIM_LAYER_NAMES[layer], stats);
+        rdpsim_stats_add(&total, stats);
+    }
+    rdpsim_print_stats("frame", &total);
+    printf("\n");
+    rdpsim_print_stats("offscreen", rdpsim_get_stats(RDPSIM_LAYER_OFFSCREEN));
+    printf("  (panels and bands baked over the whole run, not per frame)\n\n");
+
+    /* Depth complexity, leaving out the clear every pixel gets */
+    const uint8_t *const coverage = rdpsim_get_coverage();
+    long histogram[RDPSIM_COVERAGE_MAX + 1] = {0};
+    for (int i = 0; i < screen; i++)
+    {
+        histogram[coverage[i] < RDPSIM_COVERAGE_MAX ? coverage[i] : RDPSIM_COVERAGE_MAX]++;
+    }
+    const long drawn = total.writes - rdpsim_get_stats(RDPSIM_LAYER_CLEAR)->writes;
+    printf("depth: %.2f writes per pixel after the clear;", (double)drawn / screen);
+    for (int depth = 0; depth <= RDPSIM_COVERAGE_MAX; depth++)
+    {
+        printf(" %d%s %.1f%%", depth, depth == RDPSIM_COVERAGE_MAX ? "+" : "x",
+            100.0 * histogram[depth] / screen);
+    }
+    printf("\n");
+    printf("fill rate: %ld of %ld pixel writes are overdraw (%.1f%%); "
+        "about %d us of a %d us frame\n",
+        total.overdraw, total.writes, total.writes ? 100.0 * total.overdraw / total.writes : 0.0,
+        RDPMON_CYCLES_TO_US(total.cycles), RDPSIM_FRAME_US);
+}
+
+static FILE *rdpsim_open_ppm(const char *path)
+{
+    FILE *const file = fopen(path, "wb");
+    if (file == NULL) rdpsim_die("cannot write %s", path);
+    fprintf(file, "P6\n%d %d\n255\n", gfx->width, gfx->height);
+    return file;
+}
+
+static void rdpsim_write_frame(const char *path)
+{
+    FILE *const file = rdpsim_open_ppm(path);
+    const surface_t *const disp = &gfx->target;
+    for (int y = 0; y < disp->height; y++)
+    {
+        const uint16_t *const row = (const uint16_t *)((const uint8_t *)disp->buffer + y * disp->stride);
+        for (int x = 0; x < disp->width; x++)
+        {
+            const color_t c = color_from_packed16(row[x]);
+            const uint8_t rgb[3] = { c.r, c.g, c.b };
+            fwrite(rgb, 1, sizeof(rgb), file);
+        }
+    }
+    fclose(file);
+}
+
+static void rdpsim_write_heat_map(const char *path)
+{
+    FILE *const file = rdpsim_open_ppm(path);
+    const uint8_t *const coverage = rdpsim_get_coverage();
+    for (int i = 0; i < gfx->width * gfx->height; i++)
+    {
+        const int depth = coverage[i] < RDPSIM_COVERAGE_MAX ? coverage[i] : RDPSIM_COVERAGE_MAX;
+        fwrite(RDPSIM_HEAT_COLORS[depth], 1, 3, file);
+    }
+    fclose(file);
+}
+
+int main(int argc, char **argv)
+{
+    const char *png_dir = "resources/gfx";
+    const char *gen_dir = "build/gen";
+    const char *rom_dir = "build/dfs";
+    const char *frame_path = NULL;
+    const char *heat_path = NULL;
+    gfx_res_mode_t res_mode = GFX_RES_LOW;
+    bool widescreen = false;
+    bool night = false;
+    int hold_frames = -1;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc)
+        {
+            sim.scene = rdpsim_parse_name(RDPSIM_SCENE_NAMES, RDPSIM_SCENES_COUNT, argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+        {
+            res_mode = rdpsim_parse_name(RDPSIM_RES_NAMES, GFX_RES_MODES_COUNT, argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-f") && i + 1 < argc) hold_frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-k") && i + 1 < argc) sim.score = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-S") && i + 1 < argc) seed = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) frame_path = argv[++i];
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc) heat_path = argv[++i];
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc) png_dir = argv[++i];
+        else if (!strcmp(argv[i], "-g") && i + 1 < argc) gen_dir = argv[++i];
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc) rom_dir = argv[++i];
+        else if (!strcmp(argv[i], "-w")) widescreen = true;
+        else if (!strcmp(argv[i], "-n")) night = true;
+        else if (!strcmp(argv[i], "-v")) rdpsim_set_verbose(true);
+        else rdpsim_die("unknown option: %s", argv[i]);
+    }
+    if (hold_frames < 0) hold_frames = RDPSIM_SCENE_HOLD_FRAMES[sim.scene];
+    rdpsim_set_dirs(png_dir, gen_dir, rom_dir);
+    srand(seed);
+
+    /* Boot like main.c, then pick the options from the title menu */
+    gfx_init();
+    bg_init();
+    bird_t *const bird = bird_init(BIRD_COLOR_YELLOW);
+    pipes_t *const pipes = pipes_init();
+    ui_t *const ui = ui_init();
+    gfx_set_res_mode(res_mode);
+    gfx_set_widescreen(widescreen);
+    if (night) bg_set_time_mode(BG_TIME_NIGHT);
+
+    /* Warm up, get to the scene, then hold it */
+    int held = -1;
+    while (held < hold_frames)
+    {
+        rdpsim_tick(bird, pipes, ui);
+        if (sim.frames < RDPSIM_WARMUP_FRAMES) continue;
+        if (held >= 0 || bird->state == RDPSIM_SCENE_STATES[sim.scene]) held++;
+        if (held < 0 && sim.frames > RDPSIM_MAX_FRAMES)
+        {
+            rdpsim_die("never reached the %s scene", RDPSIM_SCENE_NAMES[sim.scene]);
+        }
+    }
+    if (bird->state != RDPSIM_SCENE_STATES[sim.scene])
+    {
+        fprintf(stderr, "rdpsim: left the %s scene while holding it\n", RDPSIM_SCENE_NAMES[sim.scene]);
+    }
+
+    rdpsim_draw(bird, pipes, ui);
+    rdpsim_report(bird);
+    if (frame_path) rdpsim_write_frame(frame_path);
+    if (heat_path) rdpsim_write_heat_map(heat_path);
+
+    ui_free(ui);
+    pipes_free(pipes);
+    bird_free(bird);
+    return 0;
+}
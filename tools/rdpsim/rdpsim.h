@@ -0,0 +1,61 @@
+/**
+ * FlappyBird-N64 - rdpsim.h
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ */
+
+#ifndef __RDPSIM_H
+#define __RDPSIM_H
+
+#include "libdragon.h"
+
+/* Simulator definitions */
+
+/* Where a primitive's pixels are charged; draws into panels are OFFSCREEN */
+typedef enum
+{
+    RDPSIM_LAYER_OFFSCREEN,
+    RDPSIM_LAYER_CLEAR,
+    RDPSIM_LAYER_SKY,
+    RDPSIM_LAYER_PIPES,
+    RDPSIM_LAYER_BIRD,
+    RDPSIM_LAYER_GROUND,
+    RDPSIM_LAYER_UI,
+    // Additional layers go above this line
+    RDPSIM_LAYERS_COUNT // Not a layer; just a count
+} rdpsim_layer_t;
+
+typedef struct rdpsim_stats_s
+{
+    long prims;
+    long pixels;        // Covered by a primitive, whether written or not
+    long writes;        // Pixels that passed every test and were stored
+    long overdraw;      // ...onto a pixel something else already drew
+    long texels;        // Texture samples; four per pixel when filtering
+    long tmem_bytes;    // Texture and palette bytes loaded into TMEM
+    long cycles;        // Estimated RDP clocks for all of the above
+} rdpsim_stats_t;
+
+/* Heat map limit; pixels drawn more often than this share its color */
+#define RDPSIM_COVERAGE_MAX 5
+
+/* Simulator functions */
+
+void rdpsim_set_layer(rdpsim_layer_t layer);
+
+const rdpsim_stats_t *rdpsim_get_stats(rdpsim_layer_t layer);
+
+const uint8_t *rdpsim_get_coverage(void);
+
+bool rdpsim_is_display(const surface_t *surface);
+
+void rdpsim_advance_ticks(uint64_t ticks);
+
+void rdpsim_set_verbose(bool verbose);
+
+void rdpsim_set_dirs(const char *png_dir, const char *gen_dir, const char *rom_dir);
+
+#endif
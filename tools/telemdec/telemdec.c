@@ -0,0 +1,647 @@
+/**
+ * FlappyBird-N64 - telemdec.c
+ *
+ * Copyright 2017-2022, Christopher Bonhage
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE.txt file in the root directory of this source tree.
+ *
+ * Host-side decoder for the telemetry records the ROM writes into its debug
+ * channel (see src/record.h).
+ *
+ * Usage:
+ *   telemdec [-o frames.csv] [-e FlappyBird.elf] [-c stacks.txt] [-t] [capture]
+ *
+ * Reads a captured debug stream from a file, or from stdin (or a named pipe
+ * standing in for the cartridge) when no file or "-" is given. Frame
+ * records are written as CSV, to stdout unless -o is given, and summary
+ * statistics go to stderr. With -t, the debugf text between records is
+ * echoed to stderr as well.
+ *
+ * Program counter samples (from a ROM built with SAMPLE_HZ) are symbolized
+ * against the ELF given with -e and summarized as a flat profile; -c writes
+ * them as collapsed stacks, one "outer;...;inner count" line per distinct
+ * stack, ready for flamegraph.pl.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "record.h"
+
+/* Common definitions */
+
+#define TELEMDEC_MAX_LINE 256
+#define TELEMDEC_MAX_NAME  128
+#define TELEMDEC_TOP_FUNCS 25
+
+static const char *const SCOPE_NAMES[RECORD_FRAME_SCOPES] = RECORD_FRAME_SCOPE_NAMES;
+
+typedef enum
+{
+    PARSE_SYNC0,
+    PARSE_SYNC1,
+    PARSE_TYPE,
+    PARSE_LENGTH,
+    PARSE_PAYLOAD,
+    PARSE_CHECKSUM,
+} parse_state_t;
+
+/* One program counter sample; addresses are innermost first */
+typedef struct sample_s
+{
+    int depth;
+    uint32_t addrs[RECORD_SAMPLES_MAX_DEPTH];
+} sample_t;
+
+typedef struct symbol_s
+{
+    uint32_t addr;
+    uint32_t size;
+    const char *name;
+} symbol_t;
+
+typedef struct symbols_s
+{
+    uint8_t *image;
+    symbol_t *list;
+    size_t count;
+} symbols_t;
+
+typedef struct decoder_s
+{
+    /* Record framing */
+    parse_state_t state;
+    uint8_t record[RECORD_MAX_SIZE];
+    size_t record_size;
+    size_t payload_length;
+    /* Text between records */
+    bool echo_text;
+    char line[TELEMDEC_MAX_LINE];
+    size_t line_length;
+    /* Output */
+    FILE *csv;
+    /* Statistics */
+    unsigned long records;
+    unsigned long bad_checksums;
+    unsigned long unknown_records;
+    unsigned long malformed_records;
+    unsigned long frames;
+    unsigned long missing_frames;
+    unsigned long long_frames;
+    uint32_t last_frame;
+    uint32_t *frame_us;
+    size_t frame_us_capacity;
+    double scope_sum_us[RECORD_FRAME_SCOPES];
+    uint32_t scope_max_us[RECORD_FRAME_SCOPES];
+    double rdp_busy_sum_us;
+    uint32_t rdp_busy_max_us;
+    /* Profiler samples */
+    sample_t *samples;
+    size_t sample_count;
+    size_t sample_capacity;
+    unsigned sample_rate_hz;
+    unsigned long samples_dropped;
+    double sampler_handler_us;
+} decoder_t;
+
+static void die(const char *fmt, const char *arg)
+{
+    fprintf(stderr, "telemdec: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static uint16_t read_be16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static uint32_t read_be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint64_t read_be64(const uint8_t *p)
+{
+    return (uint64_t)read_be32(p) << 32 | read_be32(p + 4);
+}
+
+static void *grow(void *array, size_t *capacity, size_t element_size)
+{
+    *capacity = *capacity ? *capacity * 2 : 4096;
+    array = realloc(array, *capacity * element_size);
+    if (!array) die("out of memory%s", "");
+    return array;
+}
+
+/* Symbol handling */
+
+static int compare_symbols(const void *a, const void *b)
+{
+    const symbol_t *x = a, *y = b;
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+/* Whether [offset, offset + length) lies within a file of the given size */
+static bool elf_range_ok(uint64_t offset, uint64_t length, uint64_t size)
+{
+    return offset <= size && length <= size - offset;
+}
+
+/*
+ * Loads the function symbols of a big-endian MIPS ELF. The toolchain may
+ * emit 32- or 64-bit ELF; either way, addresses are kept as the 32-bit
+ * KSEG0 addresses the sampler reports. Every offset is checked against
+ * the file, so a truncated or stale ELF is an error rather than a crash.
+ */
+static void symbols_load(symbols_t *syms, const char *path)
+{
+    FILE *const file = fopen(path, "rb");
+    if (!file) die("cannot open ELF: %s", path);
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *const image = malloc(size);
+    if (!image || fread(image, 1, size, file) != (size_t)size) die("cannot read ELF: %s", path);
+    fclose(file);
+    if (size < 64 || memcmp(image, "\x7F" "ELF", 4)) die("not an ELF file: %s", path);
+    if (image[5] != 2) die("not a big-endian ELF: %s", path);
+
+    const bool elf64 = (image[4] == 2);
+    const uint64_t shoff = elf64 ? read_be64(&image[0x28]) : read_be32(&image[0x20]);
+    const unsigned shentsize = read_be16(&image[elf64 ? 0x3A : 0x2E]);
+    const unsigned shnum = read_be16(&image[elf64 ? 0x3C : 0x30]);
+    if (shentsize < (elf64 ? 64u : 40u) ||
+        !elf_range_ok(shoff, (uint64_t)shnum * shentsize, size)) die("corrupt ELF: %s", path);
+    syms->image = image;
+    for (unsigned i = 0; i < shnum; i++)
+    {
+        const uint8_t *const sh = &image[shoff + i * shentsize];
+        if (read_be32(&sh[4]) != 2) continue; // SHT_SYMTAB
+        const uint64_t offset = elf64 ? read_be64(&sh[24]) : read_be32(&sh[16]);
+        const uint64_t length = elf64 ? read_be64(&sh[32]) : read_be32(&sh[20]);
+        const unsigned link = read_be32(&sh[elf64 ? 40 : 24]);
+        const unsigned entsize = elf64 ? 24 : 16;
+        if (!elf_range_ok(offset, length, size) || link >= shnum) die("corrupt ELF: %s", path);
+        const uint8_t *const strsh = &image[shoff + link * shentsize];
+        const uint64_t stroffset = elf64 ? read_be64(&strsh[24]) : read_be32(&strsh[16]);
+        const uint64_t strlength = elf64 ? read_be64(&strsh[32]) : read_be32(&strsh[20]);
+        if (!elf_range_ok(stroffset, strlength, size)) die("corrupt ELF: %s", path);
+        const char *const strtab = (const char *)&image[stroffset];
+        for (uint64_t sym = offset; sym + entsize <= offset + length; sym += entsize)
+        {
+            const uint8_t *const st = &image[sym];
+            const uint8_t info = st[elf64 ? 4 : 12];
+            const uint64_t value = elf64 ? read_be64(&st[8]) : read_be32(&st[4]);
+            const uint64_t extent = elf64 ? read_be64(&st[16]) : read_be32(&st[8]);
+            if ((info & 0xF) != 2 || extent == 0) continue; // STT_FUNC
+            const uint32_t name = read_be32(&st[0]);
+            if (name >= strlength || !memchr(strtab + name, '\0', strlength - name))
+            {
+                die("corrupt ELF: %s", path);
+            }
+            if (syms->count % 1024 == 0)
+            {
+                syms->list = realloc(syms->list, (syms->count + 1024) * sizeof(symbol_t));
+                if (!syms->list) die("out of memory%s", "");
+            }
+            syms->list[syms->count++] = (symbol_t){
+                .addr = (uint32_t)value,
+                .size = (uint32_t)extent,
+                .name = strtab + name,
+            };
+        }
+    }
+    if (syms->count == 0) die("no function symbols in ELF: %s", path);
+    qsort(syms->list, syms->count, sizeof(symbol_t), compare_symbols);
+}
+
+/* Index of the function containing addr, or count if there is none */
+static size_t symbols_find(const symbols_t *syms, uint32_t addr)
+{
+    size_t lo = 0, hi = syms->count;
+    while (lo < hi)
+    {
+        const size_t mid = (lo + hi) / 2;
+        if (syms->list[mid].addr <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return syms->count;
+    const symbol_t *const sym = &syms->list[lo - 1];
+    return (addr - sym->addr < sym->size) ? lo - 1 : syms->count;
+}
+
+/* Return addresses point past the call's delay slot; look up the call itself */
+static uint32_t sample_lookup_addr(const sample_t *sample, int frame)
+{
+    return frame ? sample->addrs[frame] - 8 : sample->addrs[frame];
+}
+
+static void symbols_name(const symbols_t *syms, uint32_t addr, char *name)
+{
+    const size_t index = symbols_find(syms, addr);
+    if (index < syms->count) snprintf(name, TELEMDEC_MAX_NAME, "%s", syms->list[index].name);
+    else snprintf(name, TELEMDEC_MAX_NAME, "0x%08X", addr);
+}
+
+/* Text handling */
+
+static void decoder_text(decoder_t *dec, uint8_t byte)
+{
+    if (!dec->echo_text) return;
+    if (byte == '\n' || dec->line_length == TELEMDEC_MAX_LINE - 1)
+    {
+        dec->line[dec->line_length] = '\0';
+        fprintf(stderr, "%s\n", dec->line);
+        dec->line_length = 0;
+        if (byte == '\n') return;
+    }
+    dec->line[dec->line_length++] = byte;
+}
+
+/* Frame records */
+
+static void decoder_csv_header(decoder_t *dec)
+{
+    fprintf(dec->csv, "frame,frame_us,vblanks,bird_state,score,rdp_busy_us,rdp_blocked_us,rdp_bytes");
+    for (int scope = 0; scope < RECORD_FRAME_SCOPES; scope++)
+    {
+        fprintf(dec->csv, ",%s_us", SCOPE_NAMES[scope]);
+    }
+    fprintf(dec->csv, "\n");
+}
+
+static void decoder_frame(decoder_t *dec, const uint8_t *payload, size_t length)
+{
+    if (length != sizeof(record_frame_t))
+    {
+        dec->malformed_records++;
+        return;
+    }
+#define FIELD(name) (payload + offsetof(record_frame_t, name))
+    const uint32_t frame = read_be32(FIELD(frame));
+    const uint32_t frame_us = read_be32(FIELD(frame_us));
+    const unsigned vblanks = *FIELD(vblanks);
+    const unsigned bird_state = *FIELD(bird_state);
+    const unsigned score = read_be16(FIELD(score));
+    const uint32_t rdp_busy_us = read_be16(FIELD(rdp_busy_us));
+    const uint32_t rdp_blocked_us = read_be16(FIELD(rdp_blocked_us));
+    const uint32_t rdp_bytes = read_be32(FIELD(rdp_bytes));
+
+    fprintf(dec->csv, "%u,%u,%u,%u,%u,%u,%u,%u", frame, frame_us, vblanks, bird_state,
+        score, rdp_busy_us, rdp_blocked_us, rdp_bytes);
+    for (int scope = 0; scope < RECORD_FRAME_SCOPES; scope++)
+    {
+        const uint32_t us = read_be16(FIELD(scope_us) + scope * sizeof(uint16_t));
+        fprintf(dec->csv, ",%u", us);
+        dec->scope_sum_us[scope] += us;
+        if (us > dec->scope_max_us[scope]) dec->scope_max_us[scope] = us;
+    }
+    fprintf(dec->csv, "\n");
+#undef FIELD
+
+    /* Streaming can be toggled, so only short gaps count as lost records */
+    if (dec->frames > 0 && frame > dec->last_frame + 1 && frame - dec->last_frame < 60)
+    {
+        dec->missing_frames += frame - dec->last_frame - 1;
+    }
+    dec->last_frame = frame;
+    if (vblanks > 2) dec->long_frames++;
+    dec->rdp_busy_sum_us += rdp_busy_us;
+    if (rdp_busy_us > dec->rdp_busy_max_us) dec->rdp_busy_max_us = rdp_busy_us;
+
+    if (dec->frames == dec->frame_us_capacity)
+    {
+        dec->frame_us = grow(dec->frame_us, &dec->frame_us_capacity, sizeof(uint32_t));
+    }
+    dec->frame_us[dec->frames++] = frame_us;
+}
+
+/* Profiler samples */
+
+static void decoder_samples(decoder_t *dec, const uint8_t *payload, size_t length)
+{
+    if (length < sizeof(record_samples_t))
+    {
+        dec->malformed_records++;
+        return;
+    }
+    dec->sample_rate_hz = read_be16(payload + offsetof(record_samples_t, rate_hz));
+    dec->samples_dropped += read_be16(payload + offsetof(record_samples_t, dropped));
+    dec->sampler_handler_us += read_be16(payload + offsetof(record_samples_t, handler_us));
+    const unsigned count = payload[offsetof(record_samples_t, count)];
+
+    size_t offset = sizeof(record_samples_t);
+    for (unsigned i = 0; i < count; i++)
+    {
+        const int depth = (offset < length) ? payload[offset++] : 0;
+        if (depth < 1 || depth > RECORD_SAMPLES_MAX_DEPTH ||
+            offset + depth * sizeof(uint32_t) > length)
+        {
+            dec->malformed_records++;
+            return;
+        }
+        if (dec->sample_count == dec->sample_capacity)
+        {
+            dec->samples = grow(dec->samples, &dec->sample_capacity, sizeof(sample_t));
+        }
+        sample_t *const sample = &dec->samples[dec->sample_count++];
+        sample->depth = depth;
+        for (int frame = 0; frame < depth; frame++)
+        {
+            sample->addrs[frame] = read_be32(payload + offset);
+            offset += sizeof(uint32_t);
+        }
+    }
+}
+
+static void decoder_record(decoder_t *dec)
+{
+    const uint8_t type = dec->record[2];
+    const uint8_t *const payload = &dec->record[RECORD_HEADER_SIZE];
+    dec->records++;
+    switch (type)
+    {
+    case RECORD_TYPE_FRAME:
+        decoder_frame(dec, payload, dec->payload_length);
+        break;
+    case RECORD_TYPE_SAMPLES:
+        decoder_samples(dec, payload, dec->payload_length);
+        break;
+    default:
+        dec->unknown_records++;
+        break;
+    }
+}
+
+/* Framing */
+
+static void decoder_feed(decoder_t *dec, uint8_t byte);
+
+/* A frame that didn't check out was text after all; rescan past its first byte */
+static void decoder_reject(decoder_t *dec)
+{
+    uint8_t bytes[RECORD_MAX_SIZE];
+    const size_t size = dec->record_size;
+    memcpy(bytes, dec->record, size);
+    dec->state = PARSE_SYNC0;
+    dec->record_size = 0;
+    decoder_text(dec, bytes[0]);
+    for (size_t i = 1; i < size; i++)
+    {
+        decoder_feed(dec, bytes[i]);
+    }
+}
+
+static void decoder_feed(decoder_t *dec, uint8_t byte)
+{
+    if (dec->state != PARSE_SYNC0)
+    {
+        dec->record[dec->record_size++] = byte;
+    }
+    switch (dec->state)
+    {
+    case PARSE_SYNC0:
+        if (byte == RECORD_SYNC0)
+        {
+            dec->record[0] = byte;
+            dec->record_size = 1;
+            dec->state = PARSE_SYNC1;
+        }
+        else
+        {
+            decoder_text(dec, byte);
+        }
+        break;
+    case PARSE_SYNC1:
+        if (byte == RECORD_SYNC1) dec->state = PARSE_TYPE;
+        else decoder_reject(dec);
+        break;
+    case PARSE_TYPE:
+        if (byte != 0 && byte < RECORD_TYPES_END + 16) dec->state = PARSE_LENGTH;
+        else decoder_reject(dec);
+        break;
+    case PARSE_LENGTH:
+        dec->payload_length = byte;
+        dec->state = byte ? PARSE_PAYLOAD : PARSE_CHECKSUM;
+        break;
+    case PARSE_PAYLOAD:
+        if (dec->record_size == RECORD_HEADER_SIZE + dec->payload_length)
+        {
+            dec->state = PARSE_CHECKSUM;
+        }
+        break;
+    case PARSE_CHECKSUM:
+        if (byte == record_checksum(dec->record[2], dec->record[3], &dec->record[RECORD_HEADER_SIZE]))
+        {
+            decoder_record(dec);
+            dec->state = PARSE_SYNC0;
+            dec->record_size = 0;
+        }
+        else
+        {
+            dec->bad_checksums++;
+            decoder_reject(dec);
+        }
+        break;
+    }
+}
+
+/* Summary */
+
+static int compare_u32(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, size_t count, int percent)
+{
+    size_t rank = (count * percent + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+static void decoder_summary(decoder_t *dec)
+{
+    fprintf(stderr, "records: %lu (%lu frame, %lu other, %lu malformed), %lu bad checksums\n",
+        dec->records, dec->frames, dec->unknown_records, dec->malformed_records, dec->bad_checksums);
+    if (dec->frames == 0) return;
+
+    double sum = 0;
+    for (size_t i = 0; i < dec->frames; i++) sum += dec->frame_us[i];
+    qsort(dec->frame_us, dec->frames, sizeof(uint32_t), compare_u32);
+    fprintf(stderr, "frame_us: mean %.0f, p50 %u, p95 %u, p99 %u, max %u\n",
+        sum / dec->frames, percentile(dec->frame_us, dec->frames, 50),
+        percentile(dec->frame_us, dec->frames, 95), percentile(dec->frame_us, dec->frames, 99),
+        dec->frame_us[dec->frames - 1]);
+    fprintf(stderr, "frames over 2 vblanks: %lu, lost records: %lu\n",
+        dec->long_frames, dec->missing_frames);
+    fprintf(stderr, "rdp_busy_us: mean %.0f, max %u\n",
+        dec->rdp_busy_sum_us / dec->frames, dec->rdp_busy_max_us);
+    for (int scope = 0; scope < RECORD_FRAME_SCOPES; scope++)
+    {
+        fprintf(stderr, "  %-12s mean %6.0f us, max %6u us\n", SCOPE_NAMES[scope],
+            dec->scope_sum_us[scope] / dec->frames, dec->scope_max_us[scope]);
+    }
+}
+
+typedef struct profile_entry_s
+{
+    size_t symbol;
+    unsigned long self;
+    unsigned long total;
+} profile_entry_t;
+
+static int compare_profile_entries(const void *a, const void *b)
+{
+    const profile_entry_t *x = a, *y = b;
+    if (x->self != y->self) return (x->self < y->self) - (x->self > y->self);
+    return (x->total < y->total) - (x->total > y->total);
+}
+
+/* Self counts the innermost frame; total counts each function once per stack */
+static void decoder_profile(decoder_t *dec, const symbols_t *syms)
+{
+    const double samples = dec->sample_count;
+    const double seconds = (dec->sample_count + dec->samples_dropped) / (double)dec->sample_rate_hz;
+    fprintf(stderr, "samples: %zu at %u Hz, %lu dropped, handler overhead %.1f%%\n",
+        dec->sample_count, dec->sample_rate_hz, dec->samples_dropped,
+        dec->sampler_handler_us / (seconds * 10000.0));
+    if (!syms->count) return;
+
+    /* The last entry collects addresses outside any function */
+    profile_entry_t *const entries = calloc(syms->count + 1, sizeof(profile_entry_t));
+    if (!entries) die("out of memory%s", "");
+    for (size_t i = 0; i <= syms->count; i++) entries[i].symbol = i;
+    for (size_t i = 0; i < dec->sample_count; i++)
+    {
+        const sample_t *const sample = &dec->samples[i];
+        size_t seen[RECORD_SAMPLES_MAX_DEPTH];
+        for (int frame = 0; frame < sample->depth; frame++)
+        {
+            const size_t index = symbols_find(syms, sample_lookup_addr(sample, frame));
+            if (frame == 0) entries[index].self++;
+            bool counted = false;
+            for (int j = 0; j < frame; j++) counted |= (seen[j] == index);
+            if (!counted) entries[index].total++;
+            seen[frame] = index;
+        }
+    }
+    qsort(entries, syms->count + 1, sizeof(profile_entry_t), compare_profile_entries);
+
+    fprintf(stderr, "  self%%  total%%  function\n");
+    for (size_t i = 0; i < TELEMDEC_TOP_FUNCS && i <= syms->count && entries[i].total; i++)
+    {
+        const size_t index = entries[i].symbol;
+        fprintf(stderr, "  %5.1f  %6.1f  %s\n", entries[i].self * 100.0 / samples,
+            entries[i].total * 100.0 / samples,
+            (index < syms->count) ? syms->list[index].name : "[unknown]");
+    }
+    free(entries);
+}
+
+static int compare_strings(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void decoder_write_stacks(decoder_t *dec, const symbols_t *syms, const char *path)
+{
+    FILE *const file = fopen(path, "w");
+    if (!file) die("cannot write stacks: %s", path);
+    const size_t stack_size = RECORD_SAMPLES_MAX_DEPTH * TELEMDEC_MAX_NAME;
+    char **const stacks = malloc(dec->sample_count * sizeof(char *));
+    if (!stacks && dec->sample_count) die("out of memory%s", "");
+    for (size_t i = 0; i < dec->sample_count; i++)
+    {
+        const sample_t *const sample = &dec->samples[i];
+        char *const stack = malloc(stack_size);
+        if (!stack) die("out of memory%s", "");
+        stack[0] = '\0';
+        /* Flame graphs list the outermost frame first */
+        for (int frame = sample->depth - 1; frame >= 0; frame--)
+        {
+            char name[TELEMDEC_MAX_NAME];
+            symbols_name(syms, sample_lookup_addr(sample, frame), name);
+            strcat(stack, name);
+            if (frame) strcat(stack, ";");
+        }
+        stacks[i] = stack;
+    }
+    qsort(stacks, dec->sample_count, sizeof(char *), compare_strings);
+    for (size_t i = 0; i < dec->sample_count;)
+    {
+        size_t run = i + 1;
+        while (run < dec->sample_count && !strcmp(stacks[run], stacks[i])) run++;
+        fprintf(file, "%s %zu\n", stacks[i], run - i);
+        i = run;
+    }
+    for (size_t i = 0; i < dec->sample_count; i++) free(stacks[i]);
+    free(stacks);
+    fclose(file);
+}
+
+int main(int argc, char **argv)
+{
+    decoder_t dec = {0};
+    const char *input_path = NULL;
+    const char *csv_path = NULL;
+    const char *elf_path = NULL;
+    const char *stacks_path = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) csv_path = argv[++i];
+        else if (!strcmp(argv[i], "-e") && i + 1 < argc) elf_path = argv[++i];
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc) stacks_path = argv[++i];
+        else if (!strcmp(argv[i], "-t")) dec.echo_text = true;
+        else if (argv[i][0] == '-' && argv[i][1]) die("unknown option: %s", argv[i]);
+        else input_path = argv[i];
+    }
+
+    FILE *input = stdin;
+    if (input_path && strcmp(input_path, "-"))
+    {
+        input = fopen(input_path, "rb");
+        if (!input) die("cannot open capture: %s", input_path);
+    }
+    dec.csv = stdout;
+    if (csv_path)
+    {
+        dec.csv = fopen(csv_path, "w");
+        if (!dec.csv) die("cannot write CSV: %s", csv_path);
+    }
+
+    decoder_csv_header(&dec);
+    uint8_t chunk[4096];
+    size_t size;
+    while ((size = fread(chunk, 1, sizeof chunk, input)) > 0)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            decoder_feed(&dec, chunk[i]);
+        }
+    }
+    decoder_summary(&dec);
+
+    symbols_t syms = {0};
+    if (elf_path) symbols_load(&syms, elf_path);
+    if (dec.sample_count)
+    {
+        decoder_profile(&dec, &syms);
+        if (stacks_path) decoder_write_stacks(&dec, &syms, stacks_path);
+    }
+
+    if (input != stdin) fclose(input);
+    if (dec.csv != stdout) fclose(dec.csv);
+    free(dec.frame_us);
+    free(dec.samples);
+    free(syms.list);
+    free(syms.image);
+    return 0;
+}